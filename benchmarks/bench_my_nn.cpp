@@ -0,0 +1,497 @@
+/*      bench_my_nn.cpp
+ *
+ *      Benchmarks of the layers and models over a grid of layer widths,
+ *      depths and batch sizes. Each benchmark reports the samples processed
+ *      per second (items_per_second) and the arithmetic throughput (GFLOP,
+ *      shown per second).
+ *      The arguments of each benchmark are listed in its name, e.g.
+ *      BM_ModelGradient/128/4/32 is width 128, depth 4, batch size 32.
+ *      The parallel training benchmarks add the number of threads, and 
+ *      measure wall-clock time.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "activation.h"
+#include "dataset.h"
+#include "inference.h"
+#include "layer.h"
+#include "loss.h"
+#include "model.h"
+#include "optimizer.h"
+#include "plan.h"
+#include "prefetcher.h"
+#include "quantized.h"
+#include "sampler.h"
+#include "server.h"
+#include "static_model.h"
+#include "thread_pool.h"
+#include "trainer.h"
+#include "workspace.h"
+using namespace my_nn;
+
+namespace {
+
+/* A model with `depth` ReLU layers of `width` nodes on `width` inputs, and a
+ * single output. */
+Model make_model(std::size_t width, std::size_t depth) {
+    Model m(width);
+    for (std::size_t i = 0; i < depth; i++) {
+        m.add_layer(width, Activation::ReLU);
+    }
+    m.add_layer(1);
+    m.set_loss(LossFunction::LstSq);
+    return m;
+}
+
+/* Floating point operations of the forward pass for one sample */
+double forward_flops(const Model &m) {
+    double flops = 0.0;
+    for (std::size_t i = 0; i < m.layer_number(); i++) {
+        auto &layer = m.get_layer(i);
+        flops += 2.0 * layer.input() * layer.nodes();
+    }
+    return flops;
+}
+
+/* The backpropagation costs two more products per layer than the forward 
+ * pass: one for the deltas, one for the weight gradients. */
+double gradient_flops(const Model &m) {
+    return 3.0 * forward_flops(m);
+}
+
+void report(benchmark::State &state, double samples, double flops) {
+    state.SetItemsProcessed(state.iterations() * samples);
+    state.counters["GFLOP"] = benchmark::Counter(
+            state.iterations() * flops * 1e-9, benchmark::Counter::kIsRate);
+}
+
+} // namespace
+
+static void BM_LayerApply(benchmark::State &state) {
+    const std::size_t width = state.range(0);
+    Layer l(width, width, Activation::ReLU);
+    Vector input = Vector::Random(width);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(l(input));
+    }
+    report(state, 1, 2.0 * width * width);
+}
+BENCHMARK(BM_LayerApply)->Arg(32)->Arg(128)->Arg(512);
+
+static void BM_LayerForward(benchmark::State &state) {
+    const std::size_t width = state.range(0);
+    const std::size_t batch = state.range(1);
+    Layer l(width, width, Activation::ReLU);
+    Matrix inputs = Matrix::Random(width, batch);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(l.forward(inputs));
+    }
+    report(state, batch, 2.0 * width * width * batch);
+}
+BENCHMARK(BM_LayerForward)->ArgsProduct({{32, 128, 512}, {1, 32, 256}});
+
+static void BM_ModelApply(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    Vector input = Vector::Random(m.input());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m(input));
+    }
+    report(state, 1, forward_flops(m));
+}
+BENCHMARK(BM_ModelApply)->ArgsProduct({{32, 128, 512}, {2, 4}});
+
+/* The same in a preallocated context: no allocation per call. */
+static void BM_ModelApplyContext(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    Vector input = Vector::Random(m.input());
+    InferenceContext context(m);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.forward(input, context).data());
+    }
+    report(state, 1, forward_flops(m));
+}
+BENCHMARK(BM_ModelApplyContext)->ArgsProduct({{32, 128, 512}, {2, 4}});
+
+/* A tiny 8 -> 16 -> 1 model: dynamic in a context, then with static sizes */
+static void BM_TinyModelApply(benchmark::State &state) {
+    Model m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(1);
+    InferenceContext context(m);
+    Vector input = Vector::Random(8);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.forward(input, context).data());
+        benchmark::ClobberMemory();
+    }
+    report(state, 1, forward_flops(m));
+}
+BENCHMARK(BM_TinyModelApply);
+
+static void BM_StaticModelApply(benchmark::State &state) {
+    Model m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(1);
+    StaticModel<8, 16, 1> s(m);
+    StaticModel<8, 16, 1>::InputVector input = Vector::Random(8);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(s(input));
+        benchmark::ClobberMemory();
+    }
+    report(state, 1, forward_flops(m));
+}
+BENCHMARK(BM_StaticModelApply);
+
+static void BM_ModelForward(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t batch = state.range(2);
+    Matrix inputs = Matrix::Random(m.input(), batch);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.forward(inputs));
+    }
+    report(state, batch, forward_flops(m) * batch);
+}
+BENCHMARK(BM_ModelForward)->ArgsProduct({{32, 128, 512}, {2, 4}, {32, 256}});
+
+/* A model whose ReLU layers are each preceded by an affine layer of the
+ * same width, frozen: the plan folds the affine layers away. The GFLOP
+ * counter counts the flops of the model, not of the plan. */
+static void BM_PlanForward(benchmark::State &state) {
+    const std::size_t width = state.range(0);
+    Model m(width);
+    for (std::size_t i = 0; i < 2; i++) {
+        m.add_layer(width);
+        m.add_layer(width, Activation::ReLU);
+    }
+    m.add_layer(1);
+    const std::size_t batch = state.range(1);
+    Matrix inputs = Matrix::Random(width, batch);
+    InferencePlan plan = m.freeze();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(plan.forward(inputs));
+    }
+    report(state, batch, forward_flops(m) * batch);
+}
+BENCHMARK(BM_PlanForward)->ArgsProduct({{32, 128, 512}, {1, 32, 256}});
+
+/* Two ReLU layers of `width` nodes whose weights have the spectrum of an
+ * over-parameterized layer, singular values decaying as 1/i^2, applied to a
+ * batch of 32: dense (energy 0), or compressed to keep 99% (1) or 99.9% (2)
+ * of the energy of the weights. */
+static void BM_PlanLowRank(benchmark::State &state) {
+    const std::size_t width = state.range(0);
+    Model m(width);
+    m.add_layer(width, Activation::ReLU);
+    m.add_layer(width, Activation::ReLU);
+    Vector decay = Vector::LinSpaced(width, 1, width).array().square()
+        .inverse();
+    for (std::size_t i = 0; i < 2; i++) {
+        Eigen::BDCSVD<Matrix> svd(Matrix(Matrix::Random(width, width)),
+                Eigen::ComputeThinU | Eigen::ComputeThinV);
+        m.get_layer(i).weights() = svd.matrixU() * decay.asDiagonal() * 
+            svd.matrixV().transpose();
+    }
+    InferencePlan plan = m.freeze();
+    const double energy[] = {0.0, 0.99, 0.999};
+    if (state.range(1) > 0) {
+        plan.compress(energy[state.range(1)]);
+    }
+    Matrix inputs = Matrix::Random(width, 32);
+    InferenceContext context(plan, 32);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(plan.forward(inputs, context).data());
+        benchmark::ClobberMemory();
+    }
+    report(state, 32, 2.0 * plan.cost() * 32);
+    state.counters["cost"] = plan.cost();
+}
+BENCHMARK(BM_PlanLowRank)->ArgsProduct({{128, 512}, {0, 1, 2}});
+
+/* Two ReLU layers of 512 nodes with `sparsity` percent of their weights
+ * pruned, applied to a batch of 32 with dense (0) or sparse (1) products. */
+static void BM_PlanSparse(benchmark::State &state) {
+    const std::size_t width = 512;
+    auto m = make_model(width, 2);
+    m.prune(state.range(0) / 100.0);
+    InferencePlan plan = m.freeze();
+    if (state.range(1) > 0) {
+        plan.sparsify(1.0);
+    }
+    Matrix inputs = Matrix::Random(width, 32);
+    InferenceContext context(plan, 32);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(plan.forward(inputs, context).data());
+        benchmark::ClobberMemory();
+    }
+    report(state, 32, 2.0 * plan.cost() * 32);
+    state.counters["bytes"] = plan.parameter_bytes();
+}
+BENCHMARK(BM_PlanSparse)
+    ->ArgsProduct({{50, 75, 90, 95, 99}, {0, 1}});
+
+/* Clients each sending 64 single-sample requests, one after the other, to
+ * a server batching up to 32 of them: width, clients. */
+static void BM_ServerThroughput(benchmark::State &state) {
+    auto m = make_model(state.range(0), 2);
+    const std::size_t clients = state.range(1);
+    const std::size_t requests = 64;
+    InferenceServer server(m, 32, std::chrono::microseconds(100));
+    Vector input = Vector::Random(m.input());
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (std::size_t c = 0; c < clients; c++) {
+            threads.emplace_back([&] {
+                for (std::size_t i = 0; i < requests; i++) {
+                    benchmark::DoNotOptimize(server.submit(input).get());
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+    report(state, clients * requests, forward_flops(m) * clients * requests);
+    state.counters["batch"] = static_cast<double>(server.requests()) / 
+        server.batches();
+}
+BENCHMARK(BM_ServerThroughput)->ArgsProduct({{128, 512}, {1, 8, 32}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/* The same model quantized to int8, to compare with BM_ModelForward. */
+static void BM_QuantizedForward(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t batch = state.range(2);
+    Matrix inputs = Matrix::Random(m.input(), batch);
+    QuantizedModel q(m, inputs);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(q.forward(inputs));
+    }
+    report(state, batch, forward_flops(m) * batch);
+}
+BENCHMARK(BM_QuantizedForward)
+    ->ArgsProduct({{32, 128, 512}, {2, 4}, {1, 32, 256}});
+
+static void BM_ModelScore(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    Vector input = Vector::Random(m.input());
+    Vector target = Vector::Random(1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.score(input, target));
+    }
+    report(state, 1, forward_flops(m));
+}
+BENCHMARK(BM_ModelScore)->ArgsProduct({{32, 128, 512}, {2, 4}});
+
+/* Evaluation of 16384 instances, by number of threads: width, depth, 
+ * threads. */
+static void BM_ModelEvaluate(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t instances = 16384;
+    Dataset data(Matrix::Random(m.input(), instances), 
+            Matrix::Random(1, instances));
+    ThreadPool pool(state.range(2));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.evaluate(data, pool));
+    }
+    report(state, instances, forward_flops(m) * instances);
+}
+BENCHMARK(BM_ModelEvaluate)->ArgsProduct({{32, 128, 512}, {2}, {1, 2, 4, 8}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/* The allocating gradient; a batch of 1 is the per-sample gradient. */
+static void BM_ModelGradient(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t batch = state.range(2);
+    Matrix inputs = Matrix::Random(m.input(), batch);
+    Matrix targets = Matrix::Random(1, batch);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(m.gradient(inputs, targets));
+    }
+    report(state, batch, gradient_flops(m) * batch);
+}
+BENCHMARK(BM_ModelGradient)->ArgsProduct({{32, 128, 512}, {2, 4}, {1, 32, 256}});
+
+/* The gradient written in a reused workspace */
+static void BM_ModelGradientWorkspace(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t batch = state.range(2);
+    Workspace w(m, batch);
+    Matrix inputs = Matrix::Random(m.input(), batch);
+    Matrix targets = Matrix::Random(1, batch);
+    for (auto _ : state) {
+        m.gradient(inputs, targets, w);
+        benchmark::ClobberMemory();
+    }
+    report(state, batch, gradient_flops(m) * batch);
+}
+BENCHMARK(BM_ModelGradientWorkspace)
+    ->ArgsProduct({{32, 128, 512}, {2, 4}, {1, 32, 256}});
+
+/* The fused loss and output deltas of a batch of 256, for the cross-entropy
+ * after a sigmoid (0) or a softmax (1) output layer of `classes` nodes. */
+static void BM_LossDelta(benchmark::State &state) {
+    const std::size_t classes = state.range(0);
+    const std::size_t batch = 256;
+    auto &kernels = loss_kernels<elem_type>(LossFunction::LogLoss, 
+            state.range(1) == 0 ? Activation::Sigmoid : Activation::Softmax);
+    Matrix pre = Matrix::Random(classes, batch) * 4.0;
+    Vector bias = Vector::Random(classes);
+    Matrix targets = Matrix::Zero(classes, batch);
+    for (std::size_t j = 0; j < batch; j++) {
+        targets(j % classes, j) = 1.0;
+    }
+    Matrix act(classes, batch);
+    Matrix delta(classes, batch);
+    for (auto _ : state) {
+        act = pre;
+        benchmark::DoNotOptimize(kernels.loss_delta(act, bias, targets, delta, 
+                    1.0 / batch));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * classes * batch);
+}
+BENCHMARK(BM_LossDelta)->ArgsProduct({{10, 100, 1000}, {0, 1}});
+
+/* The activation pass of the training, with the derivatives, on a 256 x 256
+ * batch in float (0) or double (1), for each activation by its value in 
+ * the enum. */
+template <typename Scalar>
+static void BM_Activation(benchmark::State &state) {
+    auto &kernels = activation_kernels<Scalar>(
+            static_cast<Activation>(state.range(0)));
+    MatrixT<Scalar> pre = MatrixT<Scalar>::Random(256, 256) * Scalar(4);
+    VectorT<Scalar> bias = VectorT<Scalar>::Random(256);
+    MatrixT<Scalar> act(256, 256);
+    MatrixT<Scalar> der(256, 256);
+    for (auto _ : state) {
+        act = pre;
+        kernels.forward_derivative(act, bias, der);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * pre.size());
+}
+BENCHMARK_TEMPLATE(BM_Activation, float)->DenseRange(0, 7);
+BENCHMARK_TEMPLATE(BM_Activation, double)->DenseRange(0, 7);
+
+/* The same pass for tanh through the scalar libm, for reference. */
+template <typename Scalar>
+static void BM_ActivationScalarTanh(benchmark::State &state) {
+    MatrixT<Scalar> pre = MatrixT<Scalar>::Random(256, 256) * Scalar(4);
+    VectorT<Scalar> bias = VectorT<Scalar>::Random(256);
+    MatrixT<Scalar> act(256, 256);
+    MatrixT<Scalar> der(256, 256);
+    for (auto _ : state) {
+        act = pre;
+        for (Eigen::Index j = 0; j < act.cols(); j++) {
+            for (Eigen::Index i = 0; i < act.rows(); i++) {
+                act(i, j) = std::tanh(act(i, j) + bias(i));
+                der(i, j) = Scalar(1) - act(i, j) * act(i, j);
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * pre.size());
+}
+BENCHMARK_TEMPLATE(BM_ActivationScalarTanh, float);
+BENCHMARK_TEMPLATE(BM_ActivationScalarTanh, double);
+
+/* One epoch over 1024 instances */
+static void BM_ModelTrain(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t batch = state.range(2);
+    const std::size_t instances = 1024;
+    Dataset data(Matrix::Random(m.input(), instances), 
+            Matrix::Random(1, instances));
+    SGD optimizer(1e-3);
+    for (auto _ : state) {
+        m.train(data, 1, batch, optimizer);
+    }
+    report(state, instances, gradient_flops(m) * instances);
+}
+BENCHMARK(BM_ModelTrain)->ArgsProduct({{32, 128, 512}, {2, 4}, {1, 32, 256}})
+    ->Unit(benchmark::kMillisecond);
+
+/* One epoch over 65536 instances, whose features (32 MB at width 64) do not
+ * fit in the cache, by sampling: width, sampling (uniform, permutation, 
+ * block shuffle). */
+static void BM_SampledTrain(benchmark::State &state) {
+    auto m = make_model(state.range(0), 2);
+    const std::size_t instances = 65536;
+    Dataset data(Matrix::Random(m.input(), instances), 
+            Matrix::Random(1, instances));
+    Workspace workspace(m, 32);
+    SGD optimizer(1e-3);
+    Sampler sampler(instances, static_cast<Sampling>(state.range(1)));
+    for (auto _ : state) {
+        m.train(data, 1, workspace, optimizer, sampler);
+    }
+    report(state, instances, gradient_flops(m) * instances);
+}
+BENCHMARK(BM_SampledTrain)->ArgsProduct({{16, 64}, {0, 1, 2}})
+    ->Unit(benchmark::kMillisecond);
+
+/* The same, with the mini-batches gathered from float data, converted and
+ * normalized on a background thread. */
+static void BM_PrefetchTrain(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t batch = state.range(2);
+    const std::size_t instances = 1024;
+    BasicDataset<float> data(MatrixT<float>::Random(m.input(), instances), 
+            MatrixT<float>::Random(1, instances));
+    Prefetcher prefetcher(data.view(), batch, 
+            [](Eigen::Ref<Matrix> features, Eigen::Ref<Matrix>) {
+                features.colwise().normalize();
+            });
+    Workspace workspace(m, batch);
+    SGD optimizer(1e-3);
+    for (auto _ : state) {
+        m.train(prefetcher, 1, workspace, optimizer);
+    }
+    report(state, instances, gradient_flops(m) * instances);
+}
+BENCHMARK(BM_PrefetchTrain)
+    ->ArgsProduct({{32, 128, 512}, {2, 4}, {32, 256}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/* One epoch over 4096 instances, data-parallel with a reduction of the 
+ * gradients, by number of threads: width, depth, batch size, threads. */
+static void BM_ParallelTrain(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t batch = state.range(2);
+    const std::size_t instances = 4096;
+    Dataset data(Matrix::Random(m.input(), instances), 
+            Matrix::Random(1, instances));
+    ParallelTrainer trainer(m, batch, state.range(3));
+    SGD optimizer(1e-3);
+    for (auto _ : state) {
+        trainer.train(data, 1, optimizer);
+    }
+    report(state, instances, gradient_flops(m) * instances);
+}
+BENCHMARK(BM_ParallelTrain)
+    ->ArgsProduct({{128, 512}, {2}, {256}, {1, 2, 4, 8, 16}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/* The same with Hogwild updates: each thread runs mini-batches of 
+ * batch / threads instances without synchronization. */
+static void BM_HogwildTrain(benchmark::State &state) {
+    auto m = make_model(state.range(0), state.range(1));
+    const std::size_t batch = state.range(2);
+    const std::size_t instances = 4096;
+    Dataset data(Matrix::Random(m.input(), instances), 
+            Matrix::Random(1, instances));
+    ParallelTrainer trainer(m, batch, state.range(3));
+    for (auto _ : state) {
+        trainer.train_hogwild(data, 1, 1e-3);
+    }
+    report(state, instances, gradient_flops(m) * instances);
+}
+BENCHMARK(BM_HogwildTrain)
+    ->ArgsProduct({{128, 512}, {2}, {256}, {1, 2, 4, 8, 16}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,176 @@
+/*      activation.cpp
+ *
+ *      The kernels of the activation functions.
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include "Eigen/Dense"
+
+#include "activation.h"
+#include "layer.h"
+
+namespace my_nn {
+
+namespace {
+
+template <typename Scalar, typename Op>
+void forward_kernel(Eigen::Ref<MatrixT<Scalar>> act, 
+        const Eigen::Ref<const VectorT<Scalar>> &bias) {
+    for (Eigen::Index j = 0; j < act.cols(); j++) {
+        act.col(j) = (act.col(j) + bias).unaryExpr(Op());
+    }
+}
+
+/* The overloads computing the output and the derivative together, for the
+ * activations whose derivative is a function of their output. */
+template <typename Scalar, typename Op, typename DerivativeOp>
+struct from_output_op {
+    Scalar operator()(const Scalar &x, Scalar &der) const {
+        const Scalar y = Op()(x);
+        der = DerivativeOp()(y);
+        return y;
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &x, Packet &der) const {
+        const Packet y = Op().packetOp(x);
+        der = DerivativeOp().packetOp(y);
+        return y;
+    }
+};
+
+/* Adds the bias and applies Op to each column of `act`, writing the 
+ * derivatives in `der`, in one pass of packets. Eigen expressions only have
+ * one destination, hence the explicit loop. */
+template <typename Scalar, typename Op>
+void forward_derivative_kernel(Eigen::Ref<MatrixT<Scalar>> act, 
+        const Eigen::Ref<const VectorT<Scalar>> &bias,
+        Eigen::Ref<MatrixT<Scalar>> der) {
+    using namespace Eigen::internal;
+    using Packet = typename packet_traits<Scalar>::type;
+    constexpr Eigen::Index size = packet_traits<Scalar>::size;
+    const Op op;
+    const Eigen::Index rows = act.rows();
+    const Scalar *b = bias.data();
+    for (Eigen::Index j = 0; j < act.cols(); j++) {
+        Scalar *a = act.col(j).data();
+        Scalar *d = der.col(j).data();
+        Eigen::Index i = 0;
+        for (; i + size <= rows; i += size) {
+            Packet dp;
+            const Packet y = op.packetOp(
+                    padd(ploadu<Packet>(a + i), ploadu<Packet>(b + i)), dp);
+            pstoreu(a + i, y);
+            pstoreu(d + i, dp);
+        }
+        for (; i < rows; i++) {
+            a[i] = op(a[i] + b[i], d[i]);
+        }
+    }
+}
+
+template <typename Scalar, typename Op, typename DerivativeOp>
+constexpr ActivationKernels<Scalar> from_output_kernels() {
+    return {
+        forward_kernel<Scalar, Op>,
+        forward_derivative_kernel<Scalar, 
+            from_output_op<Scalar, Op, DerivativeOp>>
+    };
+}
+
+/* Kernels of the layers without activation */
+template <typename Scalar>
+void bias_kernel(Eigen::Ref<MatrixT<Scalar>> act, 
+        const Eigen::Ref<const VectorT<Scalar>> &bias) {
+    act.colwise() += bias;
+}
+
+template <typename Scalar>
+void bias_derivative(Eigen::Ref<MatrixT<Scalar>> act, 
+        const Eigen::Ref<const VectorT<Scalar>> &bias,
+        Eigen::Ref<MatrixT<Scalar>> der) {
+    act.colwise() += bias;
+    der.setOnes();
+}
+
+/* Softmax, column by column; shifting by the largest pre-activation keeps 
+ * the exponentials from overflowing. */
+template <typename Scalar>
+void softmax_kernel(Eigen::Ref<MatrixT<Scalar>> act, 
+        const Eigen::Ref<const VectorT<Scalar>> &bias) {
+    for (Eigen::Index j = 0; j < act.cols(); j++) {
+        auto z = act.col(j);
+        z += bias;
+        z.array() = (z.array() - z.maxCoeff()).exp();
+        z *= Scalar(1) / z.sum();
+    }
+}
+
+/* The derivatives of softmax mix the outputs of a column, so this is only
+ * the diagonal of its Jacobian; the loss kernels differentiate the output
+ * layer without it. */
+template <typename Scalar>
+void softmax_derivative(Eigen::Ref<MatrixT<Scalar>> act, 
+        const Eigen::Ref<const VectorT<Scalar>> &bias,
+        Eigen::Ref<MatrixT<Scalar>> der) {
+    softmax_kernel<Scalar>(act, bias);
+    der = act.unaryExpr(sigmoid_derivative_op<Scalar>());
+}
+
+} // namespace
+
+template <typename Scalar>
+const ActivationKernels<Scalar> &activation_kernels(Activation activation) {
+    static const ActivationKernels<Scalar> none = {
+        bias_kernel<Scalar>,
+        bias_derivative<Scalar>
+    };
+    static const ActivationKernels<Scalar> relu = from_output_kernels<Scalar,
+          relu_op<Scalar>, relu_derivative_op<Scalar>>();
+    static const ActivationKernels<Scalar> sigmoid = from_output_kernels<
+          Scalar, sigmoid_op<Scalar>, sigmoid_derivative_op<Scalar>>();
+    static const ActivationKernels<Scalar> softmax = {
+        softmax_kernel<Scalar>,
+        softmax_derivative<Scalar>
+    };
+    static const ActivationKernels<Scalar> tanh = from_output_kernels<Scalar,
+          tanh_op<Scalar>, tanh_derivative_op<Scalar>>();
+    static const ActivationKernels<Scalar> leaky_relu = from_output_kernels<
+          Scalar, leaky_relu_op<Scalar>, leaky_relu_derivative_op<Scalar>>();
+    static const ActivationKernels<Scalar> silu = {
+        forward_kernel<Scalar, silu_op<Scalar>>,
+        forward_derivative_kernel<Scalar, silu_op<Scalar>>
+    };
+    static const ActivationKernels<Scalar> gelu = {
+        forward_kernel<Scalar, gelu_op<Scalar>>,
+        forward_derivative_kernel<Scalar, gelu_op<Scalar>>
+    };
+    switch (activation) {
+        case Activation::None:
+            return none;
+        case Activation::ReLU:
+            return relu;
+        case Activation::Sigmoid:
+            return sigmoid;
+        case Activation::Softmax:
+            return softmax;
+        case Activation::Tanh:
+            return tanh;
+        case Activation::LeakyReLU:
+            return leaky_relu;
+        case Activation::SiLU:
+            return silu;
+        case Activation::GELU:
+            return gelu;
+        default:
+            throw std::invalid_argument("No activation set");
+    }
+}
+
+template const ActivationKernels<float> &activation_kernels<float>(
+        Activation activation);
+template const ActivationKernels<double> &activation_kernels<double>(
+        Activation activation);
+
+} // namespace my_nn
@@ -0,0 +1,348 @@
+/*      activation.h
+ *
+ *      Activation functions, as Eigen functors that vectorize, and the
+ *      kernels the layers bind at construction.
+ */
+
+#ifndef ACTIVATION_H
+#define ACTIVATION_H
+
+#include <cmath>
+#include <cstdlib>
+
+#include "Eigen/Dense"
+
+namespace my_nn {
+
+/* An enum to hold the type of activation function for the layer. Softmax
+ * normalizes each column to a probability distribution; it is only meant for
+ * the output layer, where the loss kernels (loss.h) differentiate it. GELU is
+ * its tanh approximation. New activations go at the end, as checkpoints 
+ * store the values.
+ */
+enum class Activation { 
+    None, ReLU, Sigmoid, Softmax, Tanh, LeakyReLU, SiLU, GELU 
+};
+
+/* The activation functions are written as Eigen functors: operator() for a
+ * scalar, packetOp for a SIMD packet, so that Eigen vectorizes the 
+ * expressions using them. The packets only use Eigen's packet math (pexp,
+ * ptanh, ...), never the scalar libm. The derivatives take the output of the 
+ * activation rather than its input, so that the backpropagation does not 
+ * need to keep both. SiLU and GELU are not invertible, so their functors
+ * instead have overloads computing the derivative with the output, from the
+ * same sigmoid.
+ */
+template <typename Scalar>
+struct relu_op {
+    Scalar operator()(const Scalar &x) const { 
+        return x > Scalar(0) ? x : Scalar(0); 
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &x) const {
+        return Eigen::internal::pmax(x, Eigen::internal::pzero(x));
+    }
+};
+
+template <typename Scalar>
+struct relu_derivative_op {
+    Scalar operator()(const Scalar &y) const { 
+        return y > Scalar(0) ? Scalar(1) : Scalar(0); 
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &y) const {
+        using namespace Eigen::internal;
+        return pand(pcmp_lt(pzero(y), y), pset1<Packet>(Scalar(1)));
+    }
+};
+
+/* The logistic function, written so that the exponential cannot overflow:
+ * exp(-|x|) gives 1 / (1 + exp(-x)) for positive x and exp(x) / (1 + exp(x))
+ * for negative x. */
+template <typename Scalar>
+struct sigmoid_op {
+    Scalar operator()(const Scalar &x) const {
+        const Scalar e = std::exp(-std::abs(x));
+        const Scalar r = Scalar(1) / (Scalar(1) + e);
+        return x >= Scalar(0) ? r : e * r;
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &x) const {
+        using namespace Eigen::internal;
+        const Packet one = pset1<Packet>(Scalar(1));
+        const Packet e = pexp(pnegate(pabs(x)));
+        const Packet r = pdiv(one, padd(one, e));
+        return pselect(pcmp_le(pzero(x), x), r, pmul(e, r));
+    }
+};
+
+template <typename Scalar>
+struct sigmoid_derivative_op {
+    Scalar operator()(const Scalar &y) const { 
+        return y * (Scalar(1) - y); 
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &y) const {
+        using namespace Eigen::internal;
+        return pmul(y, psub(pset1<Packet>(Scalar(1)), y));
+    }
+};
+
+template <typename Scalar>
+struct tanh_op {
+    Scalar operator()(const Scalar &x) const { return std::tanh(x); }
+    template <typename Packet>
+    Packet packetOp(const Packet &x) const {
+        using namespace Eigen::internal;
+        if constexpr (packet_traits<Scalar>::HasTanh) {
+            return ptanh(x);
+        } else {
+            // tanh(|x|) = (1 - e) / (1 + e) with e = exp(-2|x|), which 
+            // cannot overflow
+            const Packet one = pset1<Packet>(Scalar(1));
+            const Packet e = pexp(pmul(pset1<Packet>(Scalar(-2)), pabs(x)));
+            const Packet t = pdiv(psub(one, e), padd(one, e));
+            return pselect(pcmp_lt(x, pzero(x)), pnegate(t), t);
+        }
+    }
+};
+
+template <typename Scalar>
+struct tanh_derivative_op {
+    Scalar operator()(const Scalar &y) const { 
+        return Scalar(1) - y * y; 
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &y) const {
+        using namespace Eigen::internal;
+        return psub(pset1<Packet>(Scalar(1)), pmul(y, y));
+    }
+};
+
+/* ReLU with a slope of 1/100 for the negative inputs. */
+template <typename Scalar>
+struct leaky_relu_op {
+    static constexpr Scalar slope = Scalar(0.01);
+    Scalar operator()(const Scalar &x) const { 
+        return x > Scalar(0) ? x : slope * x; 
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &x) const {
+        using namespace Eigen::internal;
+        // the slope is below 1
+        return pmax(x, pmul(pset1<Packet>(slope), x));
+    }
+};
+
+template <typename Scalar>
+struct leaky_relu_derivative_op {
+    Scalar operator()(const Scalar &y) const { 
+        return y > Scalar(0) ? Scalar(1) : leaky_relu_op<Scalar>::slope; 
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &y) const {
+        using namespace Eigen::internal;
+        return pselect(pcmp_lt(pzero(y), y), pset1<Packet>(Scalar(1)), 
+                pset1<Packet>(leaky_relu_op<Scalar>::slope));
+    }
+};
+
+/* SiLU: x sigmoid(x), whose derivative is s (1 + x (1 - s)) with
+ * s = sigmoid(x). */
+template <typename Scalar>
+struct silu_op {
+    Scalar operator()(const Scalar &x) const { 
+        return x * sigmoid_op<Scalar>()(x); 
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &x) const {
+        using namespace Eigen::internal;
+        return pmul(x, sigmoid_op<Scalar>().packetOp(x));
+    }
+    Scalar operator()(const Scalar &x, Scalar &der) const {
+        const Scalar s = sigmoid_op<Scalar>()(x);
+        der = s * (Scalar(1) + x * (Scalar(1) - s));
+        return x * s;
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &x, Packet &der) const {
+        using namespace Eigen::internal;
+        const Packet one = pset1<Packet>(Scalar(1));
+        const Packet s = sigmoid_op<Scalar>().packetOp(x);
+        der = pmul(s, pmadd(x, psub(one, s), one));
+        return pmul(x, s);
+    }
+};
+
+/* GELU, approximated as x (1 + tanh(u)) / 2 with u = sqrt(2/pi) (x + 
+ * 0.044715 x^3), that is x sigmoid(2u). With s = sigmoid(2u), the derivative
+ * is s + x s (1 - s) 2u'. */
+template <typename Scalar>
+struct gelu_op {
+    // 2 sqrt(2/pi) and 2 sqrt(2/pi) 0.044715
+    static constexpr Scalar linear = Scalar(1.5957691216057308);
+    static constexpr Scalar cubic = Scalar(0.0713548162726009);
+
+    Scalar operator()(const Scalar &x) const { 
+        return x * sigmoid_op<Scalar>()(x * (linear + cubic * x * x)); 
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &x) const {
+        using namespace Eigen::internal;
+        return pmul(x, sigmoid_op<Scalar>().packetOp(gate(x)));
+    }
+    Scalar operator()(const Scalar &x, Scalar &der) const {
+        const Scalar x2 = x * x;
+        const Scalar s = sigmoid_op<Scalar>()(x * (linear + cubic * x2));
+        der = s + x * s * (Scalar(1) - s) * (linear + 3 * cubic * x2);
+        return x * s;
+    }
+    template <typename Packet>
+    Packet packetOp(const Packet &x, Packet &der) const {
+        using namespace Eigen::internal;
+        const Packet one = pset1<Packet>(Scalar(1));
+        const Packet x2 = pmul(x, x);
+        const Packet s = sigmoid_op<Scalar>().packetOp(gate(x));
+        const Packet slope = pmadd(pset1<Packet>(3 * cubic), x2, 
+                pset1<Packet>(linear));
+        der = pmadd(pmul(pmul(x, s), psub(one, s)), slope, s);
+        return pmul(x, s);
+    }
+
+    private:
+        template <typename Packet>
+        static Packet gate(const Packet &x) {
+            using namespace Eigen::internal;
+            return pmul(x, pmadd(pset1<Packet>(cubic), pmul(x, x), 
+                        pset1<Packet>(linear)));
+        }
+};
+
+/* ActivationKernels
+ *
+ * The kernels implementing one activation function for a layer, picked once 
+ * when the layer is built so that applying the layer does not dispatch on
+ * the activation.
+ */
+template <typename Scalar>
+struct ActivationKernels {
+    using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+    /* Adds `bias` to each column of `act` and applies the activation, in a 
+     * single pass over `act`. */
+    void (*forward)(Eigen::Ref<Matrix> act, 
+            const Eigen::Ref<const Vector> &bias);
+    /* Same, and writes in `der` the derivative of the activation at each 
+     * coefficient, in the same pass: from the output, or for SiLU and GELU
+     * from the sigmoid computed for the output. For Softmax, whose outputs
+     * depend on each other, this is only the diagonal of its Jacobian. */
+    void (*forward_derivative)(Eigen::Ref<Matrix> act,
+            const Eigen::Ref<const Vector> &bias, Eigen::Ref<Matrix> der);
+};
+
+/* The kernels for `activation`; throws if there are none. */
+template <typename Scalar>
+const ActivationKernels<Scalar> &activation_kernels(Activation activation);
+
+extern template const ActivationKernels<float> &activation_kernels<float>(
+        Activation activation);
+extern template const ActivationKernels<double> &activation_kernels<double>(
+        Activation activation);
+
+} // namespace my_nn
+
+namespace Eigen {
+namespace internal {
+
+template <typename Scalar>
+struct functor_traits<my_nn::relu_op<Scalar>> {
+    enum {
+        Cost = NumTraits<Scalar>::AddCost,
+        PacketAccess = packet_traits<Scalar>::HasMax
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::relu_derivative_op<Scalar>> {
+    enum {
+        Cost = 2 * NumTraits<Scalar>::AddCost,
+        PacketAccess = packet_traits<Scalar>::HasCmp
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::sigmoid_op<Scalar>> {
+    enum {
+        Cost = functor_traits<scalar_exp_op<Scalar>>::Cost + 
+            scalar_div_cost<Scalar, true>::value + 
+            3 * NumTraits<Scalar>::AddCost,
+        PacketAccess = packet_traits<Scalar>::HasExp && 
+            packet_traits<Scalar>::HasDiv && packet_traits<Scalar>::HasCmp
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::sigmoid_derivative_op<Scalar>> {
+    enum {
+        Cost = NumTraits<Scalar>::AddCost + NumTraits<Scalar>::MulCost,
+        PacketAccess = packet_traits<Scalar>::Vectorizable
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::tanh_op<Scalar>> {
+    enum {
+        Cost = functor_traits<scalar_tanh_op<Scalar>>::Cost,
+        PacketAccess = packet_traits<Scalar>::HasTanh || (
+            packet_traits<Scalar>::HasExp && packet_traits<Scalar>::HasDiv &&
+            packet_traits<Scalar>::HasCmp)
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::tanh_derivative_op<Scalar>> {
+    enum {
+        Cost = NumTraits<Scalar>::AddCost + NumTraits<Scalar>::MulCost,
+        PacketAccess = packet_traits<Scalar>::Vectorizable
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::leaky_relu_op<Scalar>> {
+    enum {
+        Cost = NumTraits<Scalar>::AddCost + NumTraits<Scalar>::MulCost,
+        PacketAccess = packet_traits<Scalar>::HasMax
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::leaky_relu_derivative_op<Scalar>> {
+    enum {
+        Cost = 2 * NumTraits<Scalar>::AddCost,
+        PacketAccess = packet_traits<Scalar>::HasCmp
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::silu_op<Scalar>> {
+    enum {
+        Cost = functor_traits<my_nn::sigmoid_op<Scalar>>::Cost + 
+            NumTraits<Scalar>::MulCost,
+        PacketAccess = functor_traits<my_nn::sigmoid_op<Scalar>>::PacketAccess
+    };
+};
+
+template <typename Scalar>
+struct functor_traits<my_nn::gelu_op<Scalar>> {
+    enum {
+        Cost = functor_traits<my_nn::sigmoid_op<Scalar>>::Cost + 
+            4 * NumTraits<Scalar>::MulCost + NumTraits<Scalar>::AddCost,
+        PacketAccess = functor_traits<my_nn::sigmoid_op<Scalar>>::PacketAccess
+    };
+};
+
+} // namespace internal
+} // namespace Eigen
+
+#endif // ACTIVATION_H
@@ -0,0 +1,203 @@
+/*      checkpoint.cpp
+ *
+ *      Saving and loading models in a binary checkpoint format.
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "model.h"
+
+namespace my_nn {
+
+namespace {
+
+const char checkpoint_magic[8] = {'M', 'Y', 'N', 'N', 'C', 'K', 'P', 'T'};
+const std::uint32_t checkpoint_version = 1;
+const std::uint32_t byte_order_mark = 0x01020304;
+const std::uint64_t alignment = 64;
+
+std::uint64_t parameters_offset(std::uint64_t layer_number) {
+    std::uint64_t end = sizeof(CheckpointHeader) + 
+        layer_number * sizeof(CheckpointLayer);
+    return (end + alignment - 1) / alignment * alignment;
+}
+
+/* Checks the header read from a file of `file_size` bytes, and returns the
+ * shapes of the layers that follow it in `data`. */
+template <typename Scalar>
+std::vector<LayerShape> read_shapes(const CheckpointHeader &header,
+        const char *layers, std::uint64_t file_size) {
+    if (std::memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0) {
+        throw std::invalid_argument("Not a model checkpoint");
+    }
+    if (header.version != checkpoint_version) {
+        throw std::invalid_argument("Unsupported checkpoint version");
+    }
+    if (header.byte_order != byte_order_mark) {
+        throw std::invalid_argument("Checkpoint written with another byte order");
+    }
+    if (header.scalar_size != sizeof(Scalar)) {
+        throw std::invalid_argument("Checkpoint of another scalar type");
+    }
+    if (header.loss > static_cast<std::uint32_t>(LossFunction::LogLoss)) {
+        throw std::invalid_argument("Unknown loss function in checkpoint");
+    }
+    // each bound is checked before it is used, so that none can overflow
+    if (header.layer_number > file_size / sizeof(CheckpointLayer) ||
+            header.parameters_offset != parameters_offset(header.layer_number) ||
+            header.parameters_offset > file_size ||
+            header.parameter_number > 
+            (file_size - header.parameters_offset) / sizeof(Scalar)) {
+        throw std::invalid_argument("Truncated checkpoint");
+    }
+    std::vector<LayerShape> shapes;
+    std::uint64_t fanin = header.input_size;
+    std::uint64_t total = 0;
+    for (std::uint64_t i = 0; i < header.layer_number; i++) {
+        CheckpointLayer layer;
+        std::memcpy(&layer, layers + i * sizeof(CheckpointLayer), sizeof(layer));
+        if (layer.activation > static_cast<std::uint32_t>(Activation::GELU)) {
+            throw std::invalid_argument("Unknown activation in checkpoint");
+        }
+        const std::uint64_t remaining = header.parameter_number - total;
+        if (fanin >= remaining || layer.nodes > remaining / (fanin + 1)) {
+            throw std::invalid_argument("Inconsistent checkpoint");
+        }
+        shapes.push_back({layer.nodes, static_cast<Activation>(layer.activation)});
+        total += layer.nodes * (fanin + 1);
+        fanin = layer.nodes;
+    }
+    if (total != header.parameter_number) {
+        throw std::invalid_argument("Inconsistent checkpoint");
+    }
+    return shapes;
+}
+
+} // namespace
+
+template <typename Scalar>
+void save_model(const BasicModel<Scalar> &model, const std::string &path) {
+    CheckpointHeader header;
+    std::memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+    header.version = checkpoint_version;
+    header.byte_order = byte_order_mark;
+    header.scalar_size = sizeof(Scalar);
+    header.loss = static_cast<std::uint32_t>(model.loss());
+    header.input_size = model.input();
+    header.layer_number = model.layer_number();
+    header.parameter_number = model.parameters().size();
+    header.parameters_offset = parameters_offset(model.layer_number());
+
+    std::vector<char> prefix(header.parameters_offset, 0);
+    std::memcpy(prefix.data(), &header, sizeof(header));
+    for (std::size_t i = 0; i < model.layer_number(); i++) {
+        auto &layer = model.get_layer(i);
+        CheckpointLayer entry{layer.nodes(), 
+            static_cast<std::uint32_t>(layer.activation()), 0};
+        std::memcpy(prefix.data() + sizeof(header) + i * sizeof(entry), 
+                &entry, sizeof(entry));
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(prefix.data(), prefix.size());
+    file.write(reinterpret_cast<const char *>(model.parameters().data()),
+            header.parameter_number * sizeof(Scalar));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Cannot write the checkpoint " + path);
+    }
+}
+
+template <typename Scalar>
+BasicModel<Scalar> load_model(const std::string &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Cannot read the checkpoint " + path);
+    }
+    const std::uint64_t file_size = file.tellg();
+    file.seekg(0);
+    CheckpointHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        throw std::invalid_argument("Not a model checkpoint");
+    }
+    if (header.parameters_offset < sizeof(header) || 
+            header.parameters_offset > file_size) {
+        throw std::invalid_argument("Not a model checkpoint");
+    }
+    std::vector<char> layers(header.parameters_offset - sizeof(header));
+    file.read(layers.data(), layers.size());
+    auto shapes = read_shapes<Scalar>(header, layers.data(), file_size);
+
+    BasicModel<Scalar> model(header.input_size);
+    model.set_loss(static_cast<LossFunction>(header.loss));
+    for (auto &shape : shapes) {
+        model.add_layer(shape.nodes, shape.activation);
+    }
+    file.read(reinterpret_cast<char *>(model.parameters().data()),
+            header.parameter_number * sizeof(Scalar));
+    if (!file) {
+        throw std::runtime_error("Cannot read the checkpoint " + path);
+    }
+    return model;
+}
+
+template <typename Scalar>
+BasicModel<Scalar> map_model(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot read the checkpoint " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || 
+            static_cast<std::size_t>(status.st_size) < sizeof(CheckpointHeader)) {
+        close(fd);
+        throw std::invalid_argument("Not a model checkpoint");
+    }
+    const std::size_t size = status.st_size;
+    // private and writable: the pages are shared until the model changes them
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, 
+            fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Cannot map the checkpoint " + path);
+    }
+    // unmapped when the last model using it goes away
+    std::shared_ptr<const void> mapping(address, 
+            [size](const void *address) { 
+                munmap(const_cast<void *>(address), size); 
+            });
+
+    auto data = static_cast<char *>(address);
+    CheckpointHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    auto shapes = read_shapes<Scalar>(header, data + sizeof(header), size);
+    BasicModel<Scalar> model(header.input_size, shapes, 
+            reinterpret_cast<Scalar *>(data + header.parameters_offset), 
+            mapping);
+    model.set_loss(static_cast<LossFunction>(header.loss));
+    return model;
+}
+
+template void save_model<float>(const BasicModel<float> &model, 
+        const std::string &path);
+template void save_model<double>(const BasicModel<double> &model, 
+        const std::string &path);
+template BasicModel<float> load_model<float>(const std::string &path);
+template BasicModel<double> load_model<double>(const std::string &path);
+template BasicModel<float> map_model<float>(const std::string &path);
+template BasicModel<double> map_model<double>(const std::string &path);
+
+} // namespace my_nn
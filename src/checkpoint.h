@@ -0,0 +1,76 @@
+/*      checkpoint.h
+ *
+ *      Saving and loading models in a binary checkpoint format.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include "model.h"
+
+namespace my_nn {
+
+/* The checkpoint format, version 1, in the byte order of the machine:
+ *
+ *      CheckpointHeader
+ *      layer_number x CheckpointLayer
+ *      zero padding up to parameters_offset, a multiple of 64
+ *      parameter_number scalars: the buffer of Model::parameters()
+ *
+ * The parameters are aligned on a cache line in the file, hence in memory 
+ * when the file is mapped, and are written and read in a single call.
+ */
+struct CheckpointHeader {
+    char magic[8];              // "MYNNCKPT"
+    std::uint32_t version;
+    std::uint32_t byte_order;   // 0x01020304 as written by the machine
+    std::uint32_t scalar_size;  // sizeof the scalar type
+    std::uint32_t loss;         // LossFunction
+    std::uint64_t input_size;
+    std::uint64_t layer_number;
+    std::uint64_t parameter_number;
+    std::uint64_t parameters_offset;
+};
+
+struct CheckpointLayer {
+    std::uint64_t nodes;
+    std::uint32_t activation;   // Activation
+    std::uint32_t padding;
+};
+
+/* Writes `model` to the file at `path`. Throws std::runtime_error if the file
+ * cannot be written. */
+template <typename Scalar>
+void save_model(const BasicModel<Scalar> &model, const std::string &path);
+
+/* Reads the model in the file at `path` into memory. Throws 
+ * std::runtime_error if the file cannot be read, and std::invalid_argument 
+ * if it is not a checkpoint of a model of this scalar type. */
+template <typename Scalar>
+BasicModel<Scalar> load_model(const std::string &path);
+
+/* Same, but maps the file in memory, and the layers use their parameters in
+ * place. Nothing is copied: loading takes the same time whatever the size of 
+ * the model, and the processes mapping the same file share its pages. The
+ * mapping is private, so changing the parameters does not change the file.
+ * The mapping lasts as long as the model uses it.
+ */
+template <typename Scalar>
+BasicModel<Scalar> map_model(const std::string &path);
+
+extern template void save_model<float>(const BasicModel<float> &model, 
+        const std::string &path);
+extern template void save_model<double>(const BasicModel<double> &model, 
+        const std::string &path);
+extern template BasicModel<float> load_model<float>(const std::string &path);
+extern template BasicModel<double> load_model<double>(const std::string &path);
+extern template BasicModel<float> map_model<float>(const std::string &path);
+extern template BasicModel<double> map_model<double>(const std::string &path);
+
+} // namespace my_nn
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,78 @@
+/*      dataset.cpp
+ *
+ *      implementation file for the Dataset and DatasetView classes
+ */
+
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "layer.h"
+#include "dataset.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+BasicDatasetView<Scalar>::BasicDatasetView(const Scalar *features, 
+        const Scalar *labels, std::size_t size, std::size_t feature_size, 
+        std::size_t label_size)
+    : features_p(features, feature_size, size), 
+    labels_p(labels, label_size, size) {}
+
+template <typename Scalar>
+BasicDatasetView<Scalar>::BasicDatasetView(const Matrix &features, 
+        const Matrix &labels)
+    : features_p(features.data(), features.rows(), features.cols()),
+    labels_p(labels.data(), labels.rows(), labels.cols())
+{
+    if (features.cols() != labels.cols()) {
+        throw std::invalid_argument("Features and labels sizes differ");
+    }
+}
+
+template <typename Scalar>
+auto BasicDatasetView<Scalar>::slice(std::size_t first, std::size_t count) const
+    -> BasicDatasetView
+{
+    if (first + count > size()) {
+        throw std::invalid_argument("Slice out of the dataset");
+    }
+    return BasicDatasetView(features_p.data() + first * feature_size(), 
+            labels_p.data() + first * label_size(), count, feature_size(), 
+            label_size());
+}
+
+template <typename Scalar>
+BasicDataset<Scalar>::BasicDataset(Matrix features, Matrix labels)
+    : features_p(std::move(features)), labels_p(std::move(labels))
+{
+    if (features_p.cols() != labels_p.cols()) {
+        throw std::invalid_argument("Features and labels sizes differ");
+    }
+}
+
+template <typename Scalar>
+BasicDataset<Scalar>::BasicDataset(
+        const std::vector<std::pair<Vector, Vector>> &instances) {
+    if (instances.size() == 0) {
+        throw std::invalid_argument("No instances");
+    }
+    features_p = Matrix(instances[0].first.size(), instances.size());
+    labels_p = Matrix(instances[0].second.size(), instances.size());
+    for (std::size_t i = 0; i < instances.size(); i++) {
+        if (instances[i].first.size() != features_p.rows() ||
+                instances[i].second.size() != labels_p.rows()) {
+            throw std::invalid_argument("Instances of different sizes");
+        }
+        features_p.col(i) = instances[i].first;
+        labels_p.col(i) = instances[i].second;
+    }
+}
+
+template class BasicDatasetView<float>;
+template class BasicDatasetView<double>;
+template class BasicDataset<float>;
+template class BasicDataset<double>;
+
+} // namespace my_nn
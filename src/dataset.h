@@ -0,0 +1,88 @@
+/*      dataset.h
+ *
+ *      header file for the Dataset and DatasetView classes
+ */
+
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <cstdlib>
+#include <vector>
+
+#include "layer.h"
+
+namespace my_nn {
+
+/* BasicDatasetView
+ *
+ * A non-owning view over labeled instances. The features and the labels are
+ * each stored in one contiguous column-major buffer, one instance per column,
+ * so that a mini-batch is gathered by copying whole columns.
+ */
+template <typename Scalar>
+class BasicDatasetView {
+    public:
+        using Matrix = MatrixT<Scalar>;
+
+        /* View over external buffers holding `size` instances. */
+        BasicDatasetView(const Scalar *features, const Scalar *labels,
+                std::size_t size, std::size_t feature_size, 
+                std::size_t label_size);
+        /* View over two matrices with one instance per column. */
+        BasicDatasetView(const Matrix &features, const Matrix &labels);
+
+        std::size_t size() const { return features_p.cols(); }
+        std::size_t feature_size() const { return features_p.rows(); }
+        std::size_t label_size() const { return labels_p.rows(); }
+        const Eigen::Map<const Matrix> &features() const { return features_p; }
+        const Eigen::Map<const Matrix> &labels() const { return labels_p; }
+        /* The view over the `count` instances from `first`, e.g. a 
+         * mini-batch of a shuffled dataset. */
+        BasicDatasetView slice(std::size_t first, std::size_t count) const;
+
+    private:
+        Eigen::Map<const Matrix> features_p;
+        Eigen::Map<const Matrix> labels_p;
+};
+
+/* BasicDataset
+ *
+ * Owns the storage of labeled instances, with the same layout as the view.
+ * Converts implicitly to a view, which is what the training takes.
+ */
+template <typename Scalar>
+class BasicDataset {
+    public:
+        using Matrix = MatrixT<Scalar>;
+        using Vector = VectorT<Scalar>;
+
+        /* Takes two matrices with one instance per column. */
+        BasicDataset(Matrix features, Matrix labels);
+        /* Packs instances given as separate vectors. */
+        explicit BasicDataset(
+                const std::vector<std::pair<Vector, Vector>> &instances);
+
+        std::size_t size() const { return features_p.cols(); }
+        const Matrix &features() const { return features_p; }
+        const Matrix &labels() const { return labels_p; }
+        BasicDatasetView<Scalar> view() const { 
+            return BasicDatasetView<Scalar>(features_p, labels_p); 
+        }
+        operator BasicDatasetView<Scalar>() const { return view(); }
+
+    private:
+        Matrix features_p;
+        Matrix labels_p;
+};
+
+using DatasetView = BasicDatasetView<elem_type>;
+using Dataset = BasicDataset<elem_type>;
+
+extern template class BasicDatasetView<float>;
+extern template class BasicDatasetView<double>;
+extern template class BasicDataset<float>;
+extern template class BasicDataset<double>;
+
+} // namespace my_nn
+
+#endif // DATASET_H
@@ -0,0 +1,71 @@
+/*      inference.cpp
+ *
+ *      implementation file for the InferenceContext class
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "inference.h"
+#include "layer.h"
+#include "model.h"
+#include "plan.h"
+
+namespace my_nn {
+
+namespace {
+
+/* Without layers, the outputs are a copy of the inputs. */
+template <typename Scalar>
+std::size_t widest_layer(const BasicModel<Scalar> &model) {
+    std::size_t width = model.layer_number() == 0 ? model.input() : 0;
+    for (std::size_t i = 0; i < model.layer_number(); i++) {
+        width = std::max(width, model.get_layer(i).nodes());
+    }
+    return width;
+}
+
+template <typename Scalar>
+std::size_t widest_step(const BasicInferencePlan<Scalar> &plan) {
+    std::size_t width = plan.step_number() == 0 ? plan.input() : 0;
+    for (std::size_t i = 0; i < plan.step_number(); i++) {
+        width = std::max<std::size_t>(width, plan.get_step(i).nodes());
+    }
+    return width;
+}
+
+} // namespace
+
+template <typename Scalar>
+BasicInferenceContext<Scalar>::BasicInferenceContext(
+        const BasicModel<Scalar> &model, std::size_t batch_size)
+    : BasicInferenceContext(widest_layer(model), batch_size) {}
+
+template <typename Scalar>
+BasicInferenceContext<Scalar>::BasicInferenceContext(
+        const BasicInferencePlan<Scalar> &plan, std::size_t batch_size)
+    : BasicInferenceContext(widest_step(plan), batch_size) {}
+
+template <typename Scalar>
+BasicInferenceContext<Scalar>::BasicInferenceContext(std::size_t width,
+        std::size_t batch_size)
+    : buffers{Matrix(width, batch_size), Matrix(width, batch_size)}
+{
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+}
+
+template <typename Scalar>
+void BasicInferenceContext<Scalar>::check(std::size_t rows, 
+        std::size_t cols) const {
+    if (rows > width() || cols > batch_size()) {
+        throw std::invalid_argument("Inference context too small");
+    }
+}
+
+template class BasicInferenceContext<float>;
+template class BasicInferenceContext<double>;
+
+} // namespace my_nn
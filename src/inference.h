@@ -0,0 +1,64 @@
+/*      inference.h
+ *
+ *      header file for the InferenceContext class
+ */
+
+#ifndef INFERENCE_H
+#define INFERENCE_H
+
+#include <cstdlib>
+
+#include "layer.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+class BasicModel;
+template <typename Scalar>
+class BasicInferencePlan;
+
+/* BasicInferenceContext
+ *
+ * The buffers for applying a Model or an InferencePlan without allocating:
+ * two matrices as tall as the widest layer, for batches of up to 
+ * `batch_size` inputs, which the layers write into alternately. A context
+ * is used by one call at a time, so concurrent inference takes one context 
+ * per thread; the model itself is only read.
+ */
+template <typename Scalar>
+class BasicInferenceContext {
+    public:
+        using Matrix = MatrixT<Scalar>;
+
+        /* A context for `model`, or any model whose layers are not wider. */
+        explicit BasicInferenceContext(const BasicModel<Scalar> &model, 
+                std::size_t batch_size = 1);
+        /* A context for `plan`. */
+        explicit BasicInferenceContext(const BasicInferencePlan<Scalar> &plan, 
+                std::size_t batch_size = 1);
+        /* A context for layers of up to `width` nodes. */
+        BasicInferenceContext(std::size_t width, std::size_t batch_size);
+
+        std::size_t width() const { return buffers[0].rows(); }
+        std::size_t batch_size() const { return buffers[0].cols(); }
+        /* Throws std::invalid_argument unless the context holds `cols` 
+         * outputs of `rows` nodes. */
+        void check(std::size_t rows, std::size_t cols) const;
+        /* The outputs of the layer `index` of a stack, for `cols` inputs:
+         * the layers alternate between the two buffers. */
+        auto output(std::size_t index, std::size_t rows, std::size_t cols) {
+            return buffers[index % 2].topLeftCorner(rows, cols);
+        }
+
+    private:
+        Matrix buffers[2];
+};
+
+using InferenceContext = BasicInferenceContext<elem_type>;
+
+extern template class BasicInferenceContext<float>;
+extern template class BasicInferenceContext<double>;
+
+} // namespace my_nn
+
+#endif // INFERENCE_H
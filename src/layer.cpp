@@ -4,8 +4,8 @@
  */
 
 #include <cstdlib>
+#include <new>
 #include <random>
-#include <stdexcept>
 
 #include "Eigen/Dense"
 
@@ -13,17 +13,18 @@
 
 namespace my_nn {
 
-elem_type ReLU(elem_type x) { return x > 0.0 ? x : 0.0; }
-elem_type der_ReLU(elem_type x) { return x > 0.0 ? 1.0 : 0.0; }
-
 /* Constructor with He initialization of the weights
  */
-Layer::Layer(std::size_t fanin, std::size_t nodes, Activation activation)
-    : fanin{fanin}, nodes_p{nodes}, 
-    weights_p(nodes, fanin), bias_p(nodes), activation_p{activation}
+template <typename Scalar>
+BasicLayer<Scalar>::BasicLayer(std::size_t fanin, std::size_t nodes, 
+        Activation activation)
+    : fanin{fanin}, nodes_p{nodes}, storage(nodes * (fanin + 1)),
+    weights_p(storage.data(), nodes, fanin), 
+    bias_p(storage.data() + nodes * fanin, nodes), activation_p{activation},
+    kernels_p{&activation_kernels<Scalar>(activation)}
 {
     std::default_random_engine generator;
-    std::normal_distribution<elem_type> distribution(0.0, 2.0 / fanin);
+    std::normal_distribution<Scalar> distribution(0.0, 2.0 / fanin);
     for (auto &x: weights_p.reshaped()) { // need to flatten the matrix to iterate
         x = distribution(generator);
     }
@@ -32,22 +33,66 @@ Layer::Layer(std::size_t fanin, std::size_t nodes, Activation activation)
     }
 }
 
+template <typename Scalar>
+BasicLayer<Scalar>::BasicLayer(std::size_t fanin, std::size_t nodes, 
+        Activation activation, Scalar *parameters)
+    : fanin{fanin}, nodes_p{nodes}, storage{},
+    weights_p(parameters, nodes, fanin), 
+    bias_p(parameters + nodes * fanin, nodes), activation_p{activation},
+    kernels_p{&activation_kernels<Scalar>(activation)} {}
+
+template <typename Scalar>
+BasicLayer<Scalar>::BasicLayer(const BasicLayer &other)
+    : fanin{other.fanin}, nodes_p{other.nodes_p}, storage(other.parameters()),
+    weights_p(storage.data(), nodes_p, fanin), 
+    bias_p(storage.data() + nodes_p * fanin, nodes_p), 
+    activation_p{other.activation_p}, kernels_p{other.kernels_p} {}
+
+/* Moving keeps the parameters where they are: either the buffer moves along
+ * with the layer, or the layer keeps pointing in the buffer of its Model.
+ */
+template <typename Scalar>
+BasicLayer<Scalar>::BasicLayer(BasicLayer &&other) noexcept
+    : fanin{other.fanin}, nodes_p{other.nodes_p}, storage{},
+    weights_p(other.weights_p.data(), nodes_p, fanin),
+    bias_p(other.bias_p.data(), nodes_p), activation_p{other.activation_p},
+    kernels_p{other.kernels_p}
+{
+    storage.swap(other.storage);
+}
+
+template <typename Scalar>
+void BasicLayer<Scalar>::bind(Scalar *data) {
+    VectorMap(data, parameter_number()) = parameters();
+    // re-pointing an Eigen::Map is done by constructing it again in place
+    new (&weights_p) MatrixMap(data, nodes_p, fanin);
+    new (&bias_p) VectorMap(data + nodes_p * fanin, nodes_p);
+    storage = Vector();
+}
+
 /* Application of the layer is Matrix multiplication of the input vector by the
- * weights followed by the activation function term by term.
+ * weights followed by the bias and the activation function term by term, 
+ * fused in one pass.
  */
-Vector Layer::operator()(const Vector &input) const {
-    Vector act = weights_p * input + bias_p;
-
-    switch (activation_p) {
-        case Activation::None:
-            break;
-        case Activation::ReLU:
-            act = act.array().unaryExpr(std::ref(ReLU));
-            break;
-        default:
-            throw std::invalid_argument("No activation set");
-    }
+template <typename Scalar>
+auto BasicLayer<Scalar>::operator()(const Vector &input) const -> Vector {
+    Vector act(nodes_p);
+    act.noalias() = weights_p * input;
+    kernels_p->forward(act, bias_p);
     return act;
 }
 
+/* The batched version computes all the samples in a single matrix product.
+ */
+template <typename Scalar>
+auto BasicLayer<Scalar>::forward(const Matrix &inputs) const -> Matrix {
+    Matrix act(nodes_p, inputs.cols());
+    act.noalias() = weights_p * inputs;
+    kernels_p->forward(act, bias_p);
+    return act;
+}
+
+template class BasicLayer<float>;
+template class BasicLayer<double>;
+
 }   // namespace my_nn
@@ -9,53 +9,102 @@
 
 #include "Eigen/Dense"
 
+#include "activation.h"
+
 namespace my_nn {
 
+// the default scalar type. The classes are templates over the scalar type, 
+// instantiated for float and double; the plain names (Layer, Model, ...) are 
+// aliases for elem_type.
 using elem_type = double;
-// matrix and vector with dynamically assigned dimensions. Might become
-// parameters at some point.
-using Matrix = Eigen::Matrix<elem_type, Eigen::Dynamic, Eigen::Dynamic>;
-using Vector = Eigen::Matrix<elem_type, Eigen::Dynamic, 1>;
-
-/* An enum to hold the type of activation function for the layer. */
-enum class Activation { None, ReLU };
+// matrix and vector with dynamically assigned dimensions.
+template <typename Scalar>
+using MatrixT = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+template <typename Scalar>
+using VectorT = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+using Matrix = MatrixT<elem_type>;
+using Vector = VectorT<elem_type>;
+// views on parameters stored elsewhere
+using MatrixMap = Eigen::Map<Matrix>;
+using VectorMap = Eigen::Map<Vector>;
 
-/* the ReLU function */
-elem_type ReLU(elem_type x);
-elem_type der_ReLU(elem_type x);
+template <typename Scalar>
+class BasicModel;
 
-/* Layer
+/* BasicLayer
  * 
- * A class modeling a neural network layer. Holds its own weights.
+ * A class modeling a neural network layer. Its weights and bias are stored 
+ * next to each other in one buffer; the layer holds its own buffer, unless it
+ * belongs to a Model, which then stores the parameters of all its layers in 
+ * a single buffer. Copies of a layer always hold their own buffer.
  */
-class Layer {
+template <typename Scalar>
+class BasicLayer {
     public:
+        using Matrix = MatrixT<Scalar>;
+        using Vector = VectorT<Scalar>;
+        using MatrixMap = Eigen::Map<Matrix>;
+        using VectorMap = Eigen::Map<Vector>;
+
         /* Constructor; needs the previous layer size (`fanin`) to initialize
          * the weights. No activation function by default.
          */
-        Layer(std::size_t fanin, std::size_t nodes, 
+        BasicLayer(std::size_t fanin, std::size_t nodes, 
                 Activation activation = Activation::None);
+        /* A layer using the external buffer `parameters`, of 
+         * parameter_number() elements, without copying or initializing it.
+         */
+        BasicLayer(std::size_t fanin, std::size_t nodes, Activation activation,
+                Scalar *parameters);
+        BasicLayer(const BasicLayer &other);
+        BasicLayer(BasicLayer &&other) noexcept;
 
         /* The layer can be applied as a function to an input vector,
          * return the result. */
         Vector operator()(const Vector &input) const;
+        /* Batched application: `inputs` holds one sample per column, and the
+         * result holds the corresponding outputs, one per column. */
+        Matrix forward(const Matrix &inputs) const;
 
         std::size_t nodes() const { return nodes_p; }
         std::size_t input() const { return fanin; }
-        const Matrix &weights() const { return weights_p; }
-        Matrix &weights() { return weights_p; }
-        const Vector &bias() const { return bias_p; }
-        Vector &bias() { return bias_p; }
+        const MatrixMap &weights() const { return weights_p; }
+        MatrixMap &weights() { return weights_p; }
+        const VectorMap &bias() const { return bias_p; }
+        VectorMap &bias() { return bias_p; }
         Activation activation() const { return activation_p; }
+        /* The kernels of the activation function, bound at construction. */
+        const ActivationKernels<Scalar> &kernels() const { return *kernels_p; }
+        /* All the parameters, the weights (column-major) followed by the 
+         * bias. */
+        std::size_t parameter_number() const { return nodes_p * (fanin + 1); }
+        Eigen::Map<const Vector> parameters() const { 
+            return Eigen::Map<const Vector>(weights_p.data(), parameter_number());
+        }
+        VectorMap parameters() { 
+            return VectorMap(weights_p.data(), parameter_number()); 
+        }
         
     private:
+        friend class BasicModel<Scalar>;
+        /* Copies the parameters to `data` and uses them from there, releasing
+         * the buffer of the layer. */
+        void bind(Scalar *data);
+
         const std::size_t fanin;
         const std::size_t nodes_p;
-        Matrix weights_p;
-        Vector bias_p;
+        Vector storage;  // empty when the parameters are stored by a Model
+        MatrixMap weights_p;
+        VectorMap bias_p;
         Activation activation_p;
+        const ActivationKernels<Scalar> *kernels_p;
 };
 
+using Layer = BasicLayer<elem_type>;
+
+extern template class BasicLayer<float>;
+extern template class BasicLayer<double>;
+
 } // namespace my_nn
 
 #endif // LAYER_H
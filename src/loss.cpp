@@ -0,0 +1,209 @@
+/*      loss.cpp
+ *
+ *      The kernels of the loss functions.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "Eigen/Dense"
+
+#include "activation.h"
+#include "layer.h"
+#include "loss.h"
+
+namespace my_nn {
+
+namespace {
+
+template <typename Scalar>
+using MatrixRef = Eigen::Ref<MatrixT<Scalar>>;
+template <typename Scalar>
+using ConstMatrixRef = const Eigen::Ref<const MatrixT<Scalar>> &;
+template <typename Scalar>
+using ConstVectorRef = const Eigen::Ref<const VectorT<Scalar>> &;
+
+/* Squared error after an activation applied coefficient-wise: the error of
+ * each output is scaled by the derivative of its activation. */
+template <typename Scalar, Activation A>
+Scalar squares(MatrixRef<Scalar> act, ConstVectorRef<Scalar> bias,
+        ConstMatrixRef<Scalar> targets) {
+    activation_kernels<Scalar>(A).forward(act, bias);
+    return (act - targets).squaredNorm();
+}
+
+template <typename Scalar, Activation A>
+Scalar squares_delta(MatrixRef<Scalar> act, ConstVectorRef<Scalar> bias,
+        ConstMatrixRef<Scalar> targets, MatrixRef<Scalar> delta,
+        Scalar scale) {
+    activation_kernels<Scalar>(A).forward_derivative(act, bias, delta);
+    delta.array() *= (act - targets).array() * scale;
+    return (act - targets).squaredNorm();
+}
+
+template <typename Scalar, Activation A>
+const LossKernels<Scalar> &squares_kernels() {
+    static const LossKernels<Scalar> kernels = {
+        squares<Scalar, A>,
+        squares_delta<Scalar, A>
+    };
+    return kernels;
+}
+
+/* Squared error after softmax, whose Jacobian diag(p) - p p^T turns the
+ * error g of a column into p * (g - p.g). */
+template <typename Scalar>
+Scalar softmax_squares_delta(MatrixRef<Scalar> act,
+        ConstVectorRef<Scalar> bias, ConstMatrixRef<Scalar> targets,
+        MatrixRef<Scalar> delta, Scalar scale) {
+    activation_kernels<Scalar>(Activation::Softmax).forward(act, bias);
+    Scalar loss = 0;
+    for (Eigen::Index j = 0; j < act.cols(); j++) {
+        auto p = act.col(j);
+        auto d = delta.col(j);
+        d = p - targets.col(j);
+        loss += d.squaredNorm();
+        const Scalar projection = p.dot(d);
+        d.array() = (d.array() - projection) * p.array() * scale;
+    }
+    return loss;
+}
+
+/* Binary cross-entropy after a sigmoid, from the pre-activations z:
+ * -t log(p) - (1 - t) log(1 - p) = max(z, 0) - t z + log(1 + exp(-|z|)),
+ * where the exponential cannot overflow. The same exponential gives the
+ * sigmoid, see sigmoid_op, and the delta is p - t. log(1 + e) is taken 
+ * rather than log1p(e), which Eigen does not vectorize for double: its 
+ * absolute error stays within an epsilon. Without the deltas there is no
+ * buffer for the exponential, so the loss takes log(1 + e) from the 
+ * sigmoid as -log(max(p, 1 - p)), within an epsilon too. */
+template <typename Scalar>
+Scalar sigmoid_cross_entropy(MatrixRef<Scalar> act,
+        ConstVectorRef<Scalar> bias, ConstMatrixRef<Scalar> targets) {
+    Scalar loss = 0;
+    for (Eigen::Index j = 0; j < act.cols(); j++) {
+        auto z = act.col(j).array();
+        auto t = targets.col(j).array();
+        z += bias.array();
+        loss += (z.max(Scalar(0)) - z * t).sum();
+        z = z.unaryExpr(sigmoid_op<Scalar>());
+        loss -= z.max(Scalar(1) - z).log().sum();
+    }
+    return loss;
+}
+
+template <typename Scalar>
+Scalar sigmoid_cross_entropy_delta(MatrixRef<Scalar> act,
+        ConstVectorRef<Scalar> bias, ConstMatrixRef<Scalar> targets,
+        MatrixRef<Scalar> delta, Scalar scale) {
+    Scalar loss = 0;
+    for (Eigen::Index j = 0; j < act.cols(); j++) {
+        auto z = act.col(j).array();
+        auto t = targets.col(j).array();
+        // the column of delta holds exp(-|z|) until it gets the delta
+        auto e = delta.col(j).array();
+        z += bias.array();
+        e = (-z.abs()).exp();
+        loss += (z.max(Scalar(0)) - z * t + (Scalar(1) + e).log()).sum();
+        z = (z >= Scalar(0)).select(Scalar(1) / (Scalar(1) + e),
+                e / (Scalar(1) + e));
+        e = (z - t) * scale;
+    }
+    return loss;
+}
+
+/* Categorical cross-entropy after a softmax, from the pre-activations z:
+ * -sum t log(p) = sum(t) logsumexp(z) - t.z, with the log-sum-exp shifted by
+ * the largest pre-activation. The exponentials are those of the softmax,
+ * and the delta is sum(t) p - t. */
+template <typename Scalar, bool Delta>
+Scalar softmax_cross_entropy(MatrixRef<Scalar> act,
+        ConstVectorRef<Scalar> bias, ConstMatrixRef<Scalar> targets,
+        MatrixRef<Scalar> delta, Scalar scale) {
+    Scalar loss = 0;
+    for (Eigen::Index j = 0; j < act.cols(); j++) {
+        auto z = act.col(j);
+        auto t = targets.col(j);
+        z += bias;
+        const Scalar shift = z.maxCoeff();
+        const Scalar mass = t.sum();
+        loss -= t.dot(z);
+        z.array() = (z.array() - shift).exp();
+        const Scalar sum = z.sum();
+        loss += mass * (shift + std::log(sum));
+        z *= Scalar(1) / sum;
+        if (Delta) {
+            delta.col(j) = (mass * z - t) * scale;
+        }
+    }
+    return loss;
+}
+
+template <typename Scalar>
+Scalar softmax_cross_entropy_loss(MatrixRef<Scalar> act,
+        ConstVectorRef<Scalar> bias, ConstMatrixRef<Scalar> targets) {
+    // without the deltas, act stands in for their unused buffer
+    return softmax_cross_entropy<Scalar, false>(act, bias, targets, act,
+            Scalar(0));
+}
+
+} // namespace
+
+template <typename Scalar>
+const LossKernels<Scalar> &loss_kernels(LossFunction loss, Activation output) {
+    static const LossKernels<Scalar> squares_softmax = {
+        squares<Scalar, Activation::Softmax>,
+        softmax_squares_delta<Scalar>
+    };
+    static const LossKernels<Scalar> binary_cross_entropy = {
+        sigmoid_cross_entropy<Scalar>,
+        sigmoid_cross_entropy_delta<Scalar>
+    };
+    static const LossKernels<Scalar> cross_entropy = {
+        softmax_cross_entropy_loss<Scalar>,
+        softmax_cross_entropy<Scalar, true>
+    };
+    switch (loss) {
+        case LossFunction::LstSq:
+            switch (output) {
+                case Activation::None:
+                    return squares_kernels<Scalar, Activation::None>();
+                case Activation::ReLU:
+                    return squares_kernels<Scalar, Activation::ReLU>();
+                case Activation::Sigmoid:
+                    return squares_kernels<Scalar, Activation::Sigmoid>();
+                case Activation::Softmax:
+                    return squares_softmax;
+                case Activation::Tanh:
+                    return squares_kernels<Scalar, Activation::Tanh>();
+                case Activation::LeakyReLU:
+                    return squares_kernels<Scalar, Activation::LeakyReLU>();
+                case Activation::SiLU:
+                    return squares_kernels<Scalar, Activation::SiLU>();
+                case Activation::GELU:
+                    return squares_kernels<Scalar, Activation::GELU>();
+                default:
+                    throw std::invalid_argument("No activation set");
+            }
+        case LossFunction::LogLoss:
+            switch (output) {
+                case Activation::Sigmoid:
+                    return binary_cross_entropy;
+                case Activation::Softmax:
+                    return cross_entropy;
+                default:
+                    throw std::invalid_argument(
+                            "The log loss needs a Sigmoid or Softmax output");
+            }
+        default:
+            throw std::invalid_argument("No loss function set");
+    }
+}
+
+template const LossKernels<float> &loss_kernels<float>(
+        LossFunction loss, Activation output);
+template const LossKernels<double> &loss_kernels<double>(
+        LossFunction loss, Activation output);
+
+} // namespace my_nn
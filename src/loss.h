@@ -0,0 +1,65 @@
+/*      loss.h
+ *
+ *      Loss functions, and the kernels computing them together with the
+ *      errors of the output layer.
+ */
+
+#ifndef LOSS_H
+#define LOSS_H
+
+#include <cstdlib>
+
+#include "Eigen/Dense"
+
+#include "activation.h"
+
+namespace my_nn {
+
+/* LstSq is the squared error. LogLoss is the cross-entropy: binary, label by
+ * label, after a Sigmoid output layer, and categorical after a Softmax one.
+ */
+enum class LossFunction {
+    Unset, LstSq, LogLoss
+};
+
+/* LossKernels
+ *
+ * The kernels finishing the output layer of a model and computing the loss,
+ * for one pair of loss function and output activation. They start from the
+ * pre-activations of the layer, before the bias, so that the log loss never
+ * takes the logarithm of a saturated output: it is computed from the
+ * pre-activations, in the same pass as the activation.
+ */
+template <typename Scalar>
+struct LossKernels {
+    using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+    /* Adds `bias` to each column of `act` and applies the activation, then
+     * returns the loss between `act` and `targets`, summed over the
+     * columns. */
+    Scalar (*loss)(Eigen::Ref<Matrix> act,
+            const Eigen::Ref<const Vector> &bias,
+            const Eigen::Ref<const Matrix> &targets);
+    /* Same, and also writes in `delta` the derivative of the loss with
+     * respect to the pre-activations, times `scale`. The squared error is
+     * differentiated as half of it, as the models always did. */
+    Scalar (*loss_delta)(Eigen::Ref<Matrix> act,
+            const Eigen::Ref<const Vector> &bias,
+            const Eigen::Ref<const Matrix> &targets,
+            Eigen::Ref<Matrix> delta, Scalar scale);
+};
+
+/* The kernels for `loss` after an `output` layer; throws if there are none,
+ * e.g. for the log loss of an output layer which is not a probability. */
+template <typename Scalar>
+const LossKernels<Scalar> &loss_kernels(LossFunction loss, Activation output);
+
+extern template const LossKernels<float> &loss_kernels<float>(
+        LossFunction loss, Activation output);
+extern template const LossKernels<double> &loss_kernels<double>(
+        LossFunction loss, Activation output);
+
+} // namespace my_nn
+
+#endif // LOSS_H
@@ -0,0 +1,239 @@
+/*      mapped_dataset.cpp
+ *
+ *      implementation file for the dataset file format and the MappedDataset
+ *      class
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dataset.h"
+#include "layer.h"
+#include "mapped_dataset.h"
+
+namespace my_nn {
+
+namespace {
+
+const char dataset_magic[8] = {'M', 'Y', 'N', 'N', 'D', 'A', 'T', 'A'};
+const std::uint32_t dataset_version = 1;
+const std::uint32_t byte_order_mark = 0x01020304;
+const std::uint64_t alignment = 64;
+
+std::uint64_t align(std::uint64_t offset) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+template <typename Scalar>
+DatasetHeader make_header(std::size_t size, std::size_t feature_size,
+        std::size_t label_size) {
+    DatasetHeader header{};
+    std::memcpy(header.magic, dataset_magic, sizeof(header.magic));
+    header.version = dataset_version;
+    header.byte_order = byte_order_mark;
+    header.scalar_size = sizeof(Scalar);
+    header.size = size;
+    header.feature_size = feature_size;
+    header.label_size = label_size;
+    header.features_offset = align(sizeof(DatasetHeader));
+    header.labels_offset = align(header.features_offset + 
+            size * feature_size * sizeof(Scalar));
+    return header;
+}
+
+std::uint64_t file_length(const DatasetHeader &header) {
+    return header.labels_offset + 
+        header.size * header.label_size * header.scalar_size;
+}
+
+/* Whether the blocks of `header` fit in a file of `file_size` bytes and are
+ * indexable by a view. Each product is bounded by a division before
+ * make_header and file_length compute it, so that none can overflow. */
+bool fits(const DatasetHeader &header, std::uint64_t file_size) {
+    const std::uint64_t index_max = std::numeric_limits<Eigen::Index>::max();
+    if (header.size > index_max || header.feature_size > index_max ||
+            header.label_size > index_max) {
+        return false;
+    }
+    if (header.size == 0) {
+        return true;
+    }
+    const std::uint64_t scalars = file_size / header.scalar_size / header.size;
+    return header.feature_size <= scalars && header.label_size <= scalars;
+}
+
+/* Writes the columns of `block` at `offset` in the file. */
+template <typename Scalar>
+void write_columns(std::fstream &file, std::uint64_t offset,
+        const Eigen::Ref<const MatrixT<Scalar>> &block) {
+    file.seekp(offset);
+    if (block.outerStride() == block.rows()) {
+        file.write(reinterpret_cast<const char *>(block.data()),
+                block.size() * sizeof(Scalar));
+        return;
+    }
+    for (Eigen::Index j = 0; j < block.cols(); j++) {
+        file.write(reinterpret_cast<const char *>(block.col(j).data()),
+                block.rows() * sizeof(Scalar));
+    }
+}
+
+} // namespace
+
+template <typename Scalar>
+BasicDatasetWriter<Scalar>::BasicDatasetWriter(const std::string &path,
+        std::size_t size, std::size_t feature_size, std::size_t label_size)
+    : path{path}, 
+    file(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc),
+    header{make_header<Scalar>(size, feature_size, label_size)}, written_p{0}
+{
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    // gives the file its full size, the blocks are filled by append
+    std::uint64_t length = file_length(header);
+    if (length > sizeof(header)) {
+        file.seekp(length - 1);
+        file.put('\0');
+    }
+    if (!file) {
+        throw std::runtime_error("Cannot write the dataset " + path);
+    }
+}
+
+template <typename Scalar>
+void BasicDatasetWriter<Scalar>::append(
+        const Eigen::Ref<const Matrix> &features,
+        const Eigen::Ref<const Matrix> &labels) {
+    if (static_cast<std::uint64_t>(features.rows()) != header.feature_size || 
+            static_cast<std::uint64_t>(labels.rows()) != header.label_size) {
+        throw std::invalid_argument("Instances of different sizes");
+    }
+    if (features.cols() != labels.cols()) {
+        throw std::invalid_argument("Features and labels sizes differ");
+    }
+    if (written_p + features.cols() > header.size) {
+        throw std::invalid_argument("More instances than the dataset size");
+    }
+    write_columns<Scalar>(file, header.features_offset + 
+            written_p * header.feature_size * sizeof(Scalar), features);
+    write_columns<Scalar>(file, header.labels_offset + 
+            written_p * header.label_size * sizeof(Scalar), labels);
+    if (!file) {
+        throw std::runtime_error("Cannot write the dataset " + path);
+    }
+    written_p += features.cols();
+}
+
+template <typename Scalar>
+void BasicDatasetWriter<Scalar>::close() {
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Cannot write the dataset " + path);
+    }
+    if (written_p != header.size) {
+        throw std::runtime_error("Dataset " + path + " not entirely written");
+    }
+}
+
+template <typename Scalar>
+void save_dataset(const BasicDatasetView<Scalar> &data, const std::string &path) {
+    BasicDatasetWriter<Scalar> writer(path, data.size(), data.feature_size(),
+            data.label_size());
+    writer.append(data.features(), data.labels());
+    writer.close();
+}
+
+template <typename Scalar>
+BasicMappedDataset<Scalar>::BasicMappedDataset(const std::string &path)
+    : address{nullptr}, length{0}, view_p(nullptr, nullptr, 0, 0, 0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot read the dataset " + path);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || 
+            static_cast<std::size_t>(status.st_size) < sizeof(DatasetHeader)) {
+        close(fd);
+        throw std::invalid_argument("Not a dataset");
+    }
+    DatasetHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header)) {
+        close(fd);
+        throw std::runtime_error("Cannot read the dataset " + path);
+    }
+    if (std::memcmp(header.magic, dataset_magic, sizeof(header.magic)) != 0 ||
+            header.version != dataset_version) {
+        close(fd);
+        throw std::invalid_argument("Not a dataset");
+    }
+    if (header.byte_order != byte_order_mark) {
+        close(fd);
+        throw std::invalid_argument("Dataset written with another byte order");
+    }
+    if (header.scalar_size != sizeof(Scalar)) {
+        close(fd);
+        throw std::invalid_argument("Dataset of another scalar type");
+    }
+    if (!fits(header, status.st_size)) {
+        close(fd);
+        throw std::invalid_argument("Truncated dataset");
+    }
+    DatasetHeader expected = make_header<Scalar>(header.size, 
+            header.feature_size, header.label_size);
+    if (header.features_offset != expected.features_offset ||
+            header.labels_offset != expected.labels_offset ||
+            file_length(header) > static_cast<std::uint64_t>(status.st_size)) {
+        close(fd);
+        throw std::invalid_argument("Truncated dataset");
+    }
+    length = status.st_size;
+    // shared and read-only: the pages are those of the page cache
+    address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        address = nullptr;
+        throw std::runtime_error("Cannot map the dataset " + path);
+    }
+    auto data = static_cast<const char *>(address);
+    // the maps of a view cannot be reassigned
+    new (&view_p) BasicDatasetView<Scalar>(
+            reinterpret_cast<const Scalar *>(data + header.features_offset),
+            reinterpret_cast<const Scalar *>(data + header.labels_offset),
+            header.size, header.feature_size, header.label_size);
+}
+
+template <typename Scalar>
+BasicMappedDataset<Scalar>::BasicMappedDataset(BasicMappedDataset &&other) 
+    noexcept
+    : address{std::exchange(other.address, nullptr)}, 
+    length{std::exchange(other.length, 0)}, view_p{other.view_p} {}
+
+template <typename Scalar>
+BasicMappedDataset<Scalar>::~BasicMappedDataset() {
+    if (address != nullptr) {
+        munmap(address, length);
+    }
+}
+
+template class BasicDatasetWriter<float>;
+template class BasicDatasetWriter<double>;
+template class BasicMappedDataset<float>;
+template class BasicMappedDataset<double>;
+template void save_dataset<float>(const BasicDatasetView<float> &data,
+        const std::string &path);
+template void save_dataset<double>(const BasicDatasetView<double> &data,
+        const std::string &path);
+
+} // namespace my_nn
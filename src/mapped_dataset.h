@@ -0,0 +1,125 @@
+/*      mapped_dataset.h
+ *
+ *      header file for the dataset file format and the MappedDataset class
+ */
+
+#ifndef MAPPED_DATASET_H
+#define MAPPED_DATASET_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "dataset.h"
+#include "layer.h"
+
+namespace my_nn {
+
+/* The dataset file format, version 1, in the byte order of the machine:
+ *
+ *      DatasetHeader
+ *      zero padding up to features_offset
+ *      size x feature_size scalars: the features, one instance per row
+ *      zero padding up to labels_offset
+ *      size x label_size scalars: the labels, one instance per row
+ *
+ * A row-major block with one instance per row is the column-major matrix with
+ * one instance per column that a DatasetView reads, so a mapped file is used
+ * in place. Both blocks start on a multiple of 64 bytes.
+ */
+struct DatasetHeader {
+    char magic[8];              // "MYNNDATA"
+    std::uint32_t version;
+    std::uint32_t byte_order;   // 0x01020304 as written by the machine
+    std::uint32_t scalar_size;  // sizeof the scalar type
+    std::uint32_t padding;
+    std::uint64_t size;
+    std::uint64_t feature_size;
+    std::uint64_t label_size;
+    std::uint64_t features_offset;
+    std::uint64_t labels_offset;
+};
+
+/* BasicDatasetWriter
+ *
+ * Writes a dataset file of `size` instances given in chunks, so that a
+ * dataset larger than the memory can be built. The file has its full size
+ * from the start and the chunks are written in order.
+ */
+template <typename Scalar>
+class BasicDatasetWriter {
+    public:
+        using Matrix = MatrixT<Scalar>;
+
+        /* Creates the file at `path`. Throws std::runtime_error if it
+         * cannot be written. */
+        BasicDatasetWriter(const std::string &path, std::size_t size,
+                std::size_t feature_size, std::size_t label_size);
+
+        /* Appends instances, one per column. Throws std::invalid_argument
+         * if they do not fit the file. */
+        void append(const Eigen::Ref<const Matrix> &features,
+                const Eigen::Ref<const Matrix> &labels);
+        /* Flushes the file. Throws std::runtime_error if it was not entirely
+         * written. */
+        void close();
+
+        std::size_t size() const { return header.size; }
+        std::size_t written() const { return written_p; }
+
+    private:
+        std::string path;
+        std::fstream file;
+        DatasetHeader header;
+        std::size_t written_p;
+};
+
+/* Writes all the instances of `data` to the file at `path`. */
+template <typename Scalar>
+void save_dataset(const BasicDatasetView<Scalar> &data, const std::string &path);
+
+/* BasicMappedDataset
+ *
+ * A dataset file mapped in memory. Its view reads the file in place: the pages
+ * are loaded when the training reads them and can be evicted again, so the
+ * dataset can be larger than the memory. Mini-batches are views too, see
+ * DatasetView::slice. The view must not outlive the mapping.
+ */
+template <typename Scalar>
+class BasicMappedDataset {
+    public:
+        /* Maps the file at `path`. Throws std::runtime_error if it cannot be
+         * read, and std::invalid_argument if it is not a dataset of this
+         * scalar type. */
+        explicit BasicMappedDataset(const std::string &path);
+        BasicMappedDataset(const BasicMappedDataset &other) = delete;
+        BasicMappedDataset(BasicMappedDataset &&other) noexcept;
+        BasicMappedDataset &operator=(const BasicMappedDataset &other) = delete;
+        ~BasicMappedDataset();
+
+        std::size_t size() const { return view_p.size(); }
+        const BasicDatasetView<Scalar> &view() const { return view_p; }
+        operator BasicDatasetView<Scalar>() const { return view_p; }
+
+    private:
+        void *address;
+        std::size_t length;
+        BasicDatasetView<Scalar> view_p;
+};
+
+using DatasetWriter = BasicDatasetWriter<elem_type>;
+using MappedDataset = BasicMappedDataset<elem_type>;
+
+extern template class BasicDatasetWriter<float>;
+extern template class BasicDatasetWriter<double>;
+extern template class BasicMappedDataset<float>;
+extern template class BasicMappedDataset<double>;
+extern template void save_dataset<float>(const BasicDatasetView<float> &data,
+        const std::string &path);
+extern template void save_dataset<double>(const BasicDatasetView<double> &data,
+        const std::string &path);
+
+} // namespace my_nn
+
+#endif // MAPPED_DATASET_H
@@ -3,17 +3,77 @@
  *      implementation file for the Model class
  */
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
-#include <random>
+#include <memory>
+#include <new>
+#include <numeric>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
+#include "dataset.h"
+#include "inference.h"
 #include "layer.h"
+#include "loss.h"
 #include "model.h"
+#include "optimizer.h"
+#include "plan.h"
+#include "prefetcher.h"
+#include "sampler.h"
+#include "thread_pool.h"
+#include "workspace.h"
 
 namespace my_nn {
 
-void Model::add_layer(std::size_t nodes, Activation activation) {
+template <typename Scalar>
+BasicModel<Scalar>::BasicModel(const BasicModel &other)
+    : input_size{other.input_size}, layers(other.layers), loss_p{other.loss_p},
+    parameters_p{}, parameters_view(nullptr, 0), owner{}
+{
+    bind_layers();
+}
+
+template <typename Scalar>
+BasicModel<Scalar>::BasicModel(std::size_t input_size, 
+        const std::vector<LayerShape> &shapes, Scalar *parameters,
+        std::shared_ptr<const void> owner)
+    : input_size{input_size}, layers{}, loss_p{LossFunction::Unset},
+    parameters_p{}, parameters_view(nullptr, 0), owner{std::move(owner)}
+{
+    std::size_t fanin = input_size;
+    std::size_t offset = 0;
+    layers.reserve(shapes.size());
+    for (auto &shape : shapes) {
+        layers.emplace_back(fanin, shape.nodes, shape.activation, 
+                parameters + offset);
+        offset += layers.back().parameter_number();
+        fanin = shape.nodes;
+    }
+    new (&parameters_view) VectorMap(parameters, offset);
+}
+
+template <typename Scalar>
+void BasicModel<Scalar>::bind_layers() {
+    std::size_t total = 0;
+    for (const Layer &layer : layers) {
+        total += layer.parameter_number();
+    }
+    Vector buffer(total);
+    std::size_t offset = 0;
+    for (Layer &layer : layers) {
+        layer.bind(buffer.data() + offset);
+        offset += layer.parameter_number();
+    }
+    // swapping keeps the data where the layers now point
+    parameters_p.swap(buffer);
+    new (&parameters_view) VectorMap(parameters_p.data(), parameters_p.size());
+    owner.reset();
+}
+
+template <typename Scalar>
+void BasicModel<Scalar>::add_layer(std::size_t nodes, Activation activation) {
     std::size_t fanin = 0;
     if (layers.size() == 0) {
         fanin = input_size;
@@ -21,113 +81,375 @@ void Model::add_layer(std::size_t nodes, Activation activation) {
         fanin = layers[layers.size() - 1].nodes();
     }
     layers.push_back(Layer(fanin, nodes, activation));
+    bind_layers();
 }
 
-Vector Model::operator()(const Vector &input) const {
-    auto scratch = input;
-    for (const Layer &layer : layers) {
-        scratch = layer(scratch);
-    }
-    return scratch;
+template <typename Scalar>
+auto BasicModel<Scalar>::operator()(const Vector &input) const -> Vector {
+    InferenceContext context(*this);
+    return forward(input, context).col(0);
+}
+
+template <typename Scalar>
+auto BasicModel<Scalar>::forward(const Matrix &inputs) const -> Matrix {
+    InferenceContext context(*this, std::max<Eigen::Index>(inputs.cols(), 1));
+    return forward(inputs, context);
 }
 
-elem_type Model::score(const Vector &inputs, const Vector &targets) const {
-    auto results = operator()(inputs);
-    switch (loss_p) {
-        case LossFunction::LstSq:
-            return (results - targets).squaredNorm();
-        case LossFunction::LogLoss:
-            return (targets.array() * results.array().log() +
-                    (1 - targets.array()) * (1 - results.array()).log()).sum();
-        default:
-            throw std::invalid_argument("No loss function set");
+template <typename Scalar>
+auto BasicModel<Scalar>::forward(const Eigen::Ref<const Matrix> &inputs,
+        InferenceContext &context) const -> Eigen::Ref<const Matrix>
+{
+    if (static_cast<std::size_t>(inputs.rows()) != input_size) {
+        throw std::invalid_argument("Inputs do not fit the model");
     }
+    const std::size_t cols = inputs.cols();
+    if (layers.size() == 0) {
+        context.check(input_size, cols);
+        auto out = context.output(0, input_size, cols);
+        out = inputs;
+        return out;
+    }
+    forward_affine(inputs, context);
+    auto &layer = layers.back();
+    auto out = context.output(layers.size() - 1, layer.nodes(), cols);
+    layer.kernels().forward(out, layer.bias());
+    return out;
 }
 
-std::vector<std::pair<Matrix, Vector>> Model::gradient(
-        const Vector &input, const Vector &targets) const
+template <typename Scalar>
+void BasicModel<Scalar>::forward_affine(const Eigen::Ref<const Matrix> &inputs,
+        InferenceContext &context) const
 {
-    // this will store the result
-    std::vector<std::pair<Matrix, Vector>> gradients(layers.size());
-    // We need to store the activations of each node, then the error at each node.
-    std::vector<Vector> activations(layers.size());
-    
-    // forward pass
-    auto scratch = input; // stores the result at the current layer
-    for (int i = 0; i < layers.size(); i++) {
+    const std::size_t cols = inputs.cols();
+    for (std::size_t i = 0; i < layers.size(); i++) {
         auto &layer = layers[i];
-        // this part initialize the gradient with each line equal to the input
-        // while the bias terms don't need to be initialized. (they are 
-        // implicitly equal to 1
-        auto &grad = gradients[i];
-        grad.first = Matrix(layer.weights().rows(), layer.weights().cols());
-        for (int j = 0; j < layer.nodes(); j++) {
-            grad.first.row(j) = scratch.transpose();
+        context.check(layer.nodes(), cols);
+        auto out = context.output(i, layer.nodes(), cols);
+        // the first layer reads the inputs directly, to avoid copying them
+        if (i == 0) {
+            out.noalias() = layer.weights() * inputs;
+        } else {
+            out.noalias() = layer.weights() * 
+                context.output(i - 1, layers[i - 1].nodes(), cols);
+        }
+        if (i + 1 < layers.size()) {
+            layer.kernels().forward(out, layer.bias());
+        }
+    }
+}
+
+template <typename Scalar>
+Scalar BasicModel<Scalar>::score(const Vector &inputs, 
+        const Vector &targets) const {
+    if (static_cast<std::size_t>(inputs.size()) != input_size || 
+            layers.size() == 0 || 
+            static_cast<std::size_t>(targets.size()) != layers.back().nodes()) {
+        throw std::invalid_argument("Instance does not fit the model");
+    }
+    auto &kernels = loss_kernels<Scalar>(loss_p, layers.back().activation());
+    InferenceContext context(*this);
+    forward_affine(inputs, context);
+    return kernels.loss(context.output(layers.size() - 1, targets.size(), 1), 
+            layers.back().bias(), targets);
+}
+
+namespace {
+
+/* The class of an instance from its labels or outputs, see Evaluation. */
+template <typename Derived>
+Eigen::Index predicted_class(const Eigen::MatrixBase<Derived> &column) {
+    if (column.size() == 1) {
+        return column(0) > 0.5 ? 1 : 0;
+    }
+    Eigen::Index index;
+    column.maxCoeff(&index);
+    return index;
+}
+
+} // namespace
+
+template <typename Scalar>
+auto BasicModel<Scalar>::evaluate(const DatasetView &data, ThreadPool &pool,
+        std::size_t batch_size) const -> Evaluation
+{
+    if (data.feature_size() != input_size || layers.size() == 0 ||
+            data.label_size() != layers.back().nodes()) {
+        throw std::invalid_argument("Dataset does not fit the model");
+    }
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+    const std::size_t threads = pool.size();
+    const std::size_t size = data.size();
+    const std::size_t classes = std::max<std::size_t>(data.label_size(), 2);
+    auto &kernels = loss_kernels<Scalar>(loss_p, layers.back().activation());
+    std::vector<Evaluation> partial(threads, 
+            Evaluation{0, 0, 0, Evaluation::ConfusionMatrix::Zero(classes, 
+                    classes)});
+
+    pool.run([&](std::size_t index) {
+        auto &result = partial[index];
+        const std::size_t begin = size * index / threads;
+        const std::size_t end = size * (index + 1) / threads;
+        InferenceContext context(*this, batch_size);
+        for (std::size_t first = begin; first < end; first += batch_size) {
+            const std::size_t count = std::min(batch_size, end - first);
+            auto targets = data.labels().middleCols(first, count);
+            forward_affine(data.features().middleCols(first, count), context);
+            auto outputs = context.output(layers.size() - 1, 
+                    data.label_size(), count);
+            // the loss kernel applies the activation of the output layer
+            result.loss += kernels.loss(outputs, layers.back().bias(), targets);
+            for (std::size_t j = 0; j < count; j++) {
+                result.confusion(predicted_class(targets.col(j)), 
+                        predicted_class(outputs.col(j)))++;
+            }
+        }
+    });
+
+    Evaluation result = std::move(partial[0]);
+    for (std::size_t i = 1; i < threads; i++) {
+        result.loss += partial[i].loss;
+        result.confusion += partial[i].confusion;
+    }
+    result.size = size;
+    if (size > 0) {
+        result.loss /= static_cast<Scalar>(size);
+        result.accuracy = static_cast<Scalar>(result.confusion.trace()) / 
+            static_cast<Scalar>(size);
+    }
+    return result;
+}
+
+template <typename Scalar>
+auto BasicModel<Scalar>::evaluate(const DatasetView &data, std::size_t threads,
+        std::size_t batch_size) const -> Evaluation
+{
+    ThreadPool pool(threads);
+    return evaluate(data, pool, batch_size);
+}
+
+template <typename Scalar>
+void BasicModel<Scalar>::prune(Scalar sparsity) {
+    if (!(sparsity >= 0 && sparsity <= 1)) {
+        throw std::invalid_argument("Sparsity must be in [0, 1]");
+    }
+    std::vector<Eigen::Index> order;
+    for (auto &layer : layers) {
+        auto &weights = layer.weights();
+        const auto pruned = static_cast<Eigen::Index>(
+                sparsity * static_cast<Scalar>(weights.size()));
+        if (pruned == 0) {
+            continue;
+        }
+        // the indices of the `pruned` smallest weights come first
+        order.resize(weights.size());
+        std::iota(order.begin(), order.end(), Eigen::Index(0));
+        std::nth_element(order.begin(), order.begin() + (pruned - 1), 
+                order.end(), [&](Eigen::Index a, Eigen::Index b) {
+                    return std::abs(weights(a)) < std::abs(weights(b));
+                });
+        for (Eigen::Index k = 0; k < pruned; k++) {
+            weights(order[k]) = Scalar(0);
+        }
+    }
+}
+
+template <typename Scalar>
+auto BasicModel<Scalar>::freeze() const -> BasicInferencePlan<Scalar> {
+    return BasicInferencePlan<Scalar>(*this);
+}
+
+template <typename Scalar>
+auto BasicModel<Scalar>::freeze(const Vector &mean, const Vector &scale) const
+    -> BasicInferencePlan<Scalar>
+{
+    return BasicInferencePlan<Scalar>(*this, mean, scale);
+}
+
+template <typename Scalar>
+auto BasicModel<Scalar>::gradient(const Vector &input, 
+        const Vector &targets) const -> std::vector<std::pair<Matrix, Vector>>
+{
+    return gradient(Matrix(input), Matrix(targets));
+}
+
+template <typename Scalar>
+auto BasicModel<Scalar>::gradient(const Matrix &inputs, 
+        const Matrix &targets) const -> std::vector<std::pair<Matrix, Vector>>
+{
+    Workspace workspace(*this, inputs.cols());
+    gradient(inputs, targets, workspace);
+    std::vector<std::pair<Matrix, Vector>> gradients;
+    for (auto &grad : workspace.gradients()) {
+        gradients.emplace_back(grad.first, grad.second);
+    }
+    return gradients;
+}
+
+template <typename Scalar>
+void BasicModel<Scalar>::gradient(const Eigen::Ref<const Matrix> &inputs,
+        const Eigen::Ref<const Matrix> &targets, Workspace &workspace) const
+{
+    const auto batch = inputs.cols();
+    if (static_cast<std::size_t>(inputs.rows()) != input_size ||
+            layers.size() == 0 || targets.cols() != batch ||
+            static_cast<std::size_t>(targets.rows()) != layers.back().nodes()) {
+        throw std::invalid_argument("Inputs do not fit the model");
+    }
+    if (static_cast<std::size_t>(batch) > workspace.batch_size() || 
+            workspace.outputs.size() != layers.size() ||
+            workspace.flat_gradients().size() != parameters_view.size()) {
+        throw std::invalid_argument("Workspace too small for the batch");
+    }
+    // All the buffers of the workspace are as wide as its batch size; only
+    // the first `batch` columns are used.
+    // The output of each layer is the input of the next one.
+    auto layer_input = [&](std::size_t i) {
+        return workspace.outputs[i-1].leftCols(batch);
+    };
+
+    const std::size_t last = layers.size() - 1;
+    for (std::size_t i = 0; i < last; i++) {
+        if (layers[i].activation() == Activation::Softmax) {
+            throw std::invalid_argument("Softmax on a hidden layer");
         }
+    }
+    auto &loss = loss_kernels<Scalar>(
+            loss_p == LossFunction::Unset ? LossFunction::LstSq : loss_p,
+            layers[last].activation());
 
-        // compute the result of the layer.
-        auto &acts = activations[i];
-        acts = layer.weights() * scratch + layer.bias(); // no activation function
-        switch (layer.activation()) {  // apply the activation function
-                                        // then store the derivative in acts
-            case Activation::None:
-                scratch = acts;
-                acts = acts.array().unaryExpr([](elem_type x) { return 1.0; });
-                break;
-            case Activation::ReLU:
-                scratch = acts.array().unaryExpr(std::ref(ReLU));
-                acts = acts.array().unaryExpr(std::ref(der_ReLU));
-                break;
-            default:
-                throw std::invalid_argument("No activation set");
+    // forward pass, one column per sample
+    for (std::size_t i = 0; i < layers.size(); i++) {
+        auto &layer = layers[i];
+        auto out = workspace.outputs[i].leftCols(batch);
+        auto der = workspace.deltas[i].leftCols(batch);
+        if (i == 0) {
+            out.noalias() = layer.weights() * inputs;
+        } else {
+            out.noalias() = layer.weights() * layer_input(i);
+        }
+        // add the bias and apply the activation function, storing its
+        // derivative in der in the same pass
+        if (i < last) {
+            layer.kernels().forward_derivative(out, layer.bias(), der);
         }
     }
 
     // reverse pass
-    // initialize the deltas for the last node. this assumes the right pairing 
-    // of loss function and last layer activation function.
-    // the deltas are stored in activations
-    activations[layers.size()-1] = scratch - targets; // scratch containes the
-                                                   // result of the neural net
+    // the loss kernel finishes the last layer and initializes its deltas, in
+    // the same pass as the loss.
+    // the gradient is averaged over the batch, so the deltas are scaled here
+    // once rather than on every weight.
+    workspace.loss_p = loss.loss_delta(workspace.outputs[last].leftCols(batch),
+            layers[last].bias(), targets, workspace.deltas[last].leftCols(batch),
+            Scalar(1) / static_cast<Scalar>(batch));
 
     // compute the deltas by using the transpose operation and the derivative
-    // of the activation function stored in act
-    for (int i = layers.size() - 2; i >= 0; i--) {
-        auto &delt = activations[i];
-        scratch = layers[i+1].weights().transpose() * activations[i+1];
-        delt = delt.array() * scratch.array();
+    // of the activation function already stored in deltas
+    for (int i = last - 1; i >= 0; i--) {
+        auto back = workspace.scratch.topLeftCorner(layers[i].nodes(), batch);
+        back.noalias() = layers[i+1].weights().transpose() * 
+            workspace.deltas[i+1].leftCols(batch);
+        workspace.deltas[i].leftCols(batch).array() *= back.array();
     }
 
-    // collects the gradients
-    for (int i = 0; i < layers.size(); i++) {
-        auto &layer = layers[i];
-        auto &delt = activations[i];
-        auto &grad = gradients[i];
-        for (int j = 0; j < layer.input(); j++) {
-            grad.first.col(j) = grad.first.col(j).array() * delt.array();
+    // collects the gradients: one product of the deltas with the layer inputs
+    // for the whole batch.
+    for (std::size_t i = 0; i < layers.size(); i++) {
+        auto delt = workspace.deltas[i].leftCols(batch);
+        auto &grad = workspace.gradients_p[i];
+        if (i == 0) {
+            grad.first.noalias() = delt * inputs.transpose();
+        } else {
+            grad.first.noalias() = delt * layer_input(i).transpose();
         }
-        grad.second = delt;
+        grad.second = delt.rowwise().sum();
     }
-    
-    return gradients;
 }
-void Model::train(const std::vector<std::pair<Vector, Vector>> instances,
-            std::size_t epochs) {
-    auto inst_number = instances.size();
-    std::default_random_engine generator;
-    std::uniform_int_distribution<std::size_t> distribution(0, inst_number-1);
-    for (int i = 0; i < epochs; i++) {
-        for (int j = 0; j < inst_number; j++) {
-            auto index = distribution(generator);
-            auto input = instances[index].first;
-            auto labels = instances[index].second;
-            auto grad = gradient(input, labels);
-            for (int k = 0; k < layers.size(); k++) {
-                layers[k].weights() -= grad[k].first;
-                layers[k].bias() -= grad[k].second;
+
+template <typename Scalar>
+void BasicModel<Scalar>::train(
+        const std::vector<std::pair<Vector, Vector>> &instances,
+        std::size_t epochs, std::size_t batch_size) {
+    train(BasicDataset<Scalar>(instances), epochs, batch_size);
+}
+
+template <typename Scalar>
+void BasicModel<Scalar>::train(const DatasetView &data, std::size_t epochs, 
+        std::size_t batch_size) {
+    // plain descent along the gradient
+    BasicSGD<Scalar> optimizer(1.0);
+    train(data, epochs, batch_size, optimizer);
+}
+
+template <typename Scalar>
+void BasicModel<Scalar>::train(const DatasetView &data, std::size_t epochs, 
+        std::size_t batch_size, Optimizer &optimizer) {
+    Workspace workspace(*this, batch_size);
+    train(data, epochs, workspace, optimizer);
+}
+
+template <typename Scalar>
+void BasicModel<Scalar>::train(const DatasetView &data, std::size_t epochs, 
+        Workspace &workspace, Optimizer &optimizer) {
+    Sampler sampler(data.size());
+    train(data, epochs, workspace, optimizer, sampler);
+}
+
+template <typename Scalar>
+void BasicModel<Scalar>::train(const DatasetView &data, std::size_t epochs, 
+        Workspace &workspace, Optimizer &optimizer, Sampler &sampler) {
+    auto inst_number = data.size();
+    auto batch_size = workspace.batch_size();
+    auto &inputs = workspace.inputs();
+    auto &labels = workspace.targets();
+    if (data.feature_size() != input_size || 
+            data.label_size() != static_cast<std::size_t>(labels.rows())) {
+        throw std::invalid_argument("Dataset does not fit the model");
+    }
+    if (sampler.size() != inst_number) {
+        throw std::invalid_argument("Sampler of another dataset");
+    }
+    // each epoch sees as many instances as there are in the dataset
+    auto steps = (inst_number + batch_size - 1) / batch_size;
+    for (std::size_t i = 0; i < epochs; i++) {
+        for (std::size_t j = 0; j < steps; j++) {
+            for (std::size_t b = 0; b < batch_size; b++) {
+                auto index = sampler.next();
+                inputs.col(b) = data.features().col(index);
+                labels.col(b) = data.labels().col(index);
             }
+            gradient(inputs, labels, workspace);
+            optimizer.step(*this, workspace);
         }
     }
 }
 
+template <typename Scalar>
+void BasicModel<Scalar>::train(Prefetcher &batches, std::size_t epochs, 
+        Workspace &workspace, Optimizer &optimizer) {
+    auto batch_size = batches.batch_size();
+    if (batches.feature_size() != input_size || layers.size() == 0 ||
+            batches.label_size() != layers.back().nodes()) {
+        throw std::invalid_argument("Dataset does not fit the model");
+    }
+    if (batch_size > workspace.batch_size()) {
+        throw std::invalid_argument("Mini-batches wider than the workspace");
+    }
+    auto steps = (batches.size() + batch_size - 1) / batch_size;
+    for (std::size_t i = 0; i < epochs; i++) {
+        for (std::size_t j = 0; j < steps; j++) {
+            // the next batch is assembled while this one is used
+            auto &batch = batches.next();
+            gradient(batch.features, batch.labels, workspace);
+            optimizer.step(*this, workspace);
+        }
+    }
+}
+
+template class BasicModel<float>;
+template class BasicModel<double>;
+
 } // namespace my_nn
@@ -7,21 +7,89 @@
 #define MODEL_H
 
 #include <cstdlib>
+#include <memory>
 #include <vector>
 
+#include "dataset.h"
+#include "inference.h"
 #include "layer.h"
+#include "loss.h"
+#include "optimizer.h"
+#include "prefetcher.h"
+#include "sampler.h"
+#include "thread_pool.h"
+#include "workspace.h"
 
 namespace my_nn {
 
-enum class LossFunction {
-    Unset, LstSq, LogLoss
+/* The shape of a layer of a model, the number of inputs being given by the
+ * previous layer. */
+struct LayerShape {
+    std::size_t nodes;
+    Activation activation;
 };
 
-class Model {
+template <typename Scalar>
+class BasicInferencePlan;
+
+/* The result of evaluating a model on a dataset. The classification metrics
+ * take the class of an instance to be the index of its largest label, or, 
+ * for a single label, whether it is above 1/2; they are only meaningful for 
+ * models trained to classify.
+ */
+template <typename Scalar>
+struct BasicEvaluation {
+    using ConfusionMatrix = Eigen::Matrix<std::size_t, Eigen::Dynamic, 
+          Eigen::Dynamic>;
+
+    std::size_t size;       // number of instances
+    Scalar loss;            // mean of the loss over the instances
+    Scalar accuracy;        // fraction of the instances classified right
+    // number of instances of each class (row) given each class (column)
+    ConfusionMatrix confusion;
+};
+
+/* BasicModel
+ *
+ * A stack of dense layers. The parameters of all the layers are stored in one
+ * contiguous buffer, layer after layer, each layer holding its weights 
+ * (column-major) then its bias; the layers are views into that buffer.
+ * The buffer is usually owned by the model, but can also be external, e.g. a
+ * memory-mapped checkpoint.
+ */
+template <typename Scalar>
+class BasicModel {
     public:
+        using Matrix = MatrixT<Scalar>;
+        using Vector = VectorT<Scalar>;
+        using VectorMap = Eigen::Map<Vector>;
+        using Layer = BasicLayer<Scalar>;
+        using DatasetView = BasicDatasetView<Scalar>;
+        using Workspace = BasicWorkspace<Scalar>;
+        using Optimizer = BasicOptimizer<Scalar>;
+        using Prefetcher = BasicPrefetcher<Scalar>;
+        using Evaluation = BasicEvaluation<Scalar>;
+        using InferenceContext = BasicInferenceContext<Scalar>;
+
         /* Constructor: need the input size to build layers. */
-        Model(std::size_t input_size): 
-            input_size{input_size}, layers{}, loss_p{LossFunction::Unset} {}
+        BasicModel(std::size_t input_size): 
+            input_size{input_size}, layers{}, loss_p{LossFunction::Unset},
+            parameters_p{}, parameters_view(nullptr, 0), owner{} {}
+        /* Builds a model over the external buffer `parameters`, laid out
+         * like parameters(), without copying or initializing it. `owner` 
+         * keeps the buffer alive as long as the model uses it. Adding a 
+         * layer afterwards copies the parameters in a buffer of the model.
+         */
+        BasicModel(std::size_t input_size, 
+                const std::vector<LayerShape> &shapes, Scalar *parameters,
+                std::shared_ptr<const void> owner);
+        /* Copies get their own buffer of parameters. */
+        BasicModel(const BasicModel &other);
+        BasicModel(BasicModel &&other) = default;
+        /* Copy of the model with another scalar type, e.g. to run in float
+         * a model trained in double. */
+        template <typename Other>
+        BasicModel<Other> cast() const;
         /* Add a Layer at the end of the model, connected to the previous layer */
         void add_layer(std::size_t nodes, 
                 Activation activation = Activation::None); 
@@ -29,33 +97,143 @@ class Model {
         void set_loss(LossFunction loss) { loss_p = loss; }
         /* Apply the model to some input */
         Vector operator()(const Vector &input) const;
+        /* Apply the model to a batch of inputs, one sample per column. */
+        Matrix forward(const Matrix &inputs) const;
+        /* Same, in the buffers of `context` rather than in new matrices. 
+         * The result is a view into the context, valid until its next use.
+         */
+        Eigen::Ref<const Matrix> forward(const Eigen::Ref<const Matrix> &inputs,
+                InferenceContext &context) const;
         /* Compute the loss function on the difference between the result
          * of applying the model to `input` and the provided `targets`.
          */
-        elem_type score(const Vector &input, const Vector &targets) const;
+        Scalar score(const Vector &input, const Vector &targets) const;
+        /* Computes the mean loss and the classification metrics over 
+         * `data`, in mini-batches of `batch_size` instances. The dataset is
+         * split in one contiguous range per thread of `pool`, and each
+         * thread only allocates its two batch buffers.
+         */
+        Evaluation evaluate(const DatasetView &data, ThreadPool &pool,
+                std::size_t batch_size = 256) const;
+        /* Same, with a pool of `threads` threads. */
+        Evaluation evaluate(const DatasetView &data, std::size_t threads = 1,
+                std::size_t batch_size = 256) const;
+        /* Zeroes the fraction `sparsity` (in [0, 1]) of the weights of each
+         * layer with the smallest magnitudes; the biases are kept. The 
+         * training makes them nonzero again, so pruning during the training
+         * is done between calls to train, e.g. with a growing sparsity. 
+         * Freeze then sparsify the plan to run the pruned model with sparse
+         * products. */
+        void prune(Scalar sparsity);
+        /* An inference-only copy of the model, with consecutive affine 
+         * layers folded together, see InferencePlan (plan.h). */
+        BasicInferencePlan<Scalar> freeze() const;
+        /* Same, with the normalization (input - mean) * scale of the inputs
+         * folded into the first layer. */
+        BasicInferencePlan<Scalar> freeze(const Vector &mean, 
+                const Vector &scale) const;
 
-        /* Backpropagates on one input to compute the gradient. 
-         * Assumes the right pairing between output activation and loss.
+        /* Backpropagates on one input to compute the gradient. The errors
+         * of the output layer are those of the loss function, see 
+         * LossKernels (loss.h); a model without one trains on least 
+         * squares. A Softmax layer can only be the output layer.
          */
         std::vector<std::pair<Matrix, Vector>> gradient(
                 const Vector &input, const Vector &targets) const;
-        /* Training schedule. Recieves labeled instances and number of epochs.
-         * Uses stochastic gradient descent for now.
+        /* Backpropagates on a mini-batch, one sample per column of `inputs`
+         * and `targets`. The gradient is averaged over the batch.
          */
-        void train(const std::vector<std::pair<Vector, Vector>> instances,
-                std::size_t epochs);
+        std::vector<std::pair<Matrix, Vector>> gradient(
+                const Matrix &inputs, const Matrix &targets) const;
+        /* Same, but writes the gradients in `workspace` instead of 
+         * allocating them, with the loss over the batch. The batch can be 
+         * narrower than the workspace.
+         */
+        void gradient(const Eigen::Ref<const Matrix> &inputs,
+                const Eigen::Ref<const Matrix> &targets, 
+                Workspace &workspace) const;
+        /* Training schedule. Recieves labeled instances, number of epochs
+         * and the size of the mini-batches.
+         * Uses plain stochastic gradient descent with a step of 1.
+         */
+        void train(const DatasetView &data, std::size_t epochs, 
+                std::size_t batch_size = 1);
+        /* Same, with the update rule given by `optimizer`. */
+        void train(const DatasetView &data, std::size_t epochs, 
+                std::size_t batch_size, Optimizer &optimizer);
+        /* Same, reusing the buffers of `workspace`; the mini-batches are as
+         * wide as the workspace. The training steps do not allocate once the
+         * optimizer state is sized.
+         */
+        void train(const DatasetView &data, std::size_t epochs, 
+                Workspace &workspace, Optimizer &optimizer);
+        /* Same, visiting the instances in the order of `sampler`, which 
+         * continues from where it stopped in a previous call. The other 
+         * overloads visit every instance once per epoch, in a new random 
+         * order.
+         */
+        void train(const DatasetView &data, std::size_t epochs, 
+                Workspace &workspace, Optimizer &optimizer, Sampler &sampler);
+        /* Same, with the mini-batches assembled in the background by 
+         * `batches`, which must not be wider than the workspace.
+         */
+        void train(Prefetcher &batches, std::size_t epochs, 
+                Workspace &workspace, Optimizer &optimizer);
+        /* Same, from instances given as separate vectors. They are packed
+         * into a Dataset first, so prefer the other overloads for large data.
+         */
+        void train(const std::vector<std::pair<Vector, Vector>> &instances,
+                std::size_t epochs, std::size_t batch_size = 1);
 
         /* Accessor functions to specific layers */
         const Layer &get_layer(std::size_t index) const { return layers[index]; }
         Layer &get_layer(std::size_t index) { return layers[index]; }
+        std::size_t layer_number() const { return layers.size(); }
+        std::size_t input() const { return input_size; }
+        /* The buffer holding the parameters of all the layers. */
+        Eigen::Map<const Vector> parameters() const {
+            return Eigen::Map<const Vector>(parameters_view.data(), 
+                    parameters_view.size());
+        }
+        VectorMap parameters() { return parameters_view; }
         /* Accessor function to loss type */
         LossFunction loss() const { return loss_p; }
     private:
+        /* Lays out the parameters of all the layers in a new buffer. */
+        void bind_layers();
+        /* Runs the layers on `inputs` in the buffers of `context`, leaving
+         * the last one at its pre-activations, before its bias, for the loss
+         * kernels or the activation to finish. */
+        void forward_affine(const Eigen::Ref<const Matrix> &inputs,
+                InferenceContext &context) const;
+
         const std::size_t input_size;
         std::vector<Layer> layers;
         LossFunction loss_p;
+        Vector parameters_p;  // empty when the buffer is external
+        VectorMap parameters_view;  // the buffer in use
+        std::shared_ptr<const void> owner;  // keeps an external buffer alive
 };
 
+template <typename Scalar>
+template <typename Other>
+BasicModel<Other> BasicModel<Scalar>::cast() const {
+    BasicModel<Other> result(input_size);
+    result.set_loss(loss_p);
+    for (const Layer &layer : layers) {
+        result.add_layer(layer.nodes(), layer.activation());
+    }
+    // both models lay out their parameters the same way
+    result.parameters() = parameters().template cast<Other>();
+    return result;
+}
+
+using Model = BasicModel<elem_type>;
+using Evaluation = BasicEvaluation<elem_type>;
+
+extern template class BasicModel<float>;
+extern template class BasicModel<double>;
+
 } // namespace my_nn
 
 #endif // MODEL_H
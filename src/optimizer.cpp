@@ -0,0 +1,162 @@
+/*      optimizer.cpp
+ *
+ *      implementation file for the Optimizer classes
+ */
+
+#include <cmath>
+#include <cstdlib>
+
+#include "Eigen/Dense"
+
+#include "layer.h"
+#include "model.h"
+#include "optimizer.h"
+#include "workspace.h"
+
+namespace my_nn {
+
+namespace {
+
+/* Runs `kernel` over `size` elements, a SIMD packet at a time, then one 
+ * element at a time for the remainder. Eigen's packet functions also accept
+ * plain scalars, so the kernel is written once for both.
+ */
+template <typename Scalar, typename Kernel>
+void fused_pass(std::size_t size, Kernel kernel) {
+    using Packet = typename Eigen::internal::packet_traits<Scalar>::type;
+    constexpr std::size_t packet_size = 
+        Eigen::internal::packet_traits<Scalar>::size;
+    std::size_t i = 0;
+    for (; i + packet_size <= size; i += packet_size) {
+        kernel(i, Packet{});
+    }
+    for (; i < size; i++) {
+        kernel(i, Scalar{});
+    }
+}
+
+} // namespace
+
+using namespace Eigen::internal;
+
+template <typename Scalar>
+BasicOptimizer<Scalar>::BasicOptimizer(Scalar learning_rate, 
+        std::size_t state_slots)
+    : rate{learning_rate}, steps{0}, slots{state_slots}, state{} {}
+
+template <typename Scalar>
+void BasicOptimizer<Scalar>::reset(const BasicModel<Scalar> &model) {
+    state = MatrixT<Scalar>::Zero(model.parameters().size(), slots);
+    steps = 0;
+}
+
+template <typename Scalar>
+void BasicOptimizer<Scalar>::step(BasicModel<Scalar> &model, 
+        const BasicWorkspace<Scalar> &workspace) {
+    auto parameters = model.parameters();
+    if (state.rows() != parameters.size()) {
+        reset(model);
+    }
+    steps++;
+    update(parameters.data(), workspace.flat_gradients().data(), 
+            state.data(), parameters.size());
+}
+
+template <typename Scalar>
+void BasicSGD<Scalar>::update(Scalar *param, const Scalar *grad,
+        Scalar * /* state */, std::size_t size) {
+    fused_pass<Scalar>(size, [&](std::size_t i, auto p) {
+        using P = decltype(p);
+        const P r = pset1<P>(this->rate);
+        pstoreu(param + i, psub(ploadu<P>(param + i), 
+                    pmul(r, ploadu<P>(grad + i))));
+    });
+}
+
+template <typename Scalar>
+void BasicMomentum<Scalar>::update(Scalar *param, const Scalar *grad,
+        Scalar *state, std::size_t size) {
+    fused_pass<Scalar>(size, [&](std::size_t i, auto p) {
+        using P = decltype(p);
+        const P r = pset1<P>(this->rate);
+        const P mu = pset1<P>(momentum);
+        P v = psub(pmul(mu, ploadu<P>(state + i)), pmul(r, ploadu<P>(grad + i)));
+        pstoreu(state + i, v);
+        pstoreu(param + i, padd(ploadu<P>(param + i), v));
+    });
+}
+
+template <typename Scalar>
+void BasicNesterov<Scalar>::update(Scalar *param, const Scalar *grad,
+        Scalar *state, std::size_t size) {
+    fused_pass<Scalar>(size, [&](std::size_t i, auto p) {
+        using P = decltype(p);
+        const P r = pset1<P>(this->rate);
+        const P mu = pset1<P>(momentum);
+        const P one_mu = pset1<P>(1 + momentum);
+        P previous = ploadu<P>(state + i);
+        P v = psub(pmul(mu, previous), pmul(r, ploadu<P>(grad + i)));
+        pstoreu(state + i, v);
+        pstoreu(param + i, padd(ploadu<P>(param + i), 
+                    psub(pmul(one_mu, v), pmul(mu, previous))));
+    });
+}
+
+template <typename Scalar>
+void BasicRMSProp<Scalar>::update(Scalar *param, const Scalar *grad,
+        Scalar *state, std::size_t size) {
+    fused_pass<Scalar>(size, [&](std::size_t i, auto p) {
+        using P = decltype(p);
+        const P r = pset1<P>(this->rate);
+        const P d = pset1<P>(decay);
+        const P one_d = pset1<P>(1 - decay);
+        const P eps = pset1<P>(epsilon);
+        P g = ploadu<P>(grad + i);
+        P s = padd(pmul(d, ploadu<P>(state + i)), pmul(one_d, pmul(g, g)));
+        pstoreu(state + i, s);
+        pstoreu(param + i, psub(ploadu<P>(param + i), 
+                    pdiv(pmul(r, g), padd(psqrt(s), eps))));
+    });
+}
+
+template <typename Scalar>
+void BasicAdam<Scalar>::update(Scalar *param, const Scalar *grad,
+        Scalar *state, std::size_t size) {
+    // the bias corrections of both moments are folded in the step size
+    const Scalar corrected = this->rate * 
+        std::sqrt(1 - std::pow(beta2, this->steps)) /
+        (1 - std::pow(beta1, this->steps));
+    Scalar *first = state;
+    Scalar *second = state + size;
+    fused_pass<Scalar>(size, [&](std::size_t i, auto p) {
+        using P = decltype(p);
+        const P r = pset1<P>(corrected);
+        const P b1 = pset1<P>(beta1);
+        const P one_b1 = pset1<P>(1 - beta1);
+        const P b2 = pset1<P>(beta2);
+        const P one_b2 = pset1<P>(1 - beta2);
+        const P eps = pset1<P>(epsilon);
+        P g = ploadu<P>(grad + i);
+        P m = padd(pmul(b1, ploadu<P>(first + i)), pmul(one_b1, g));
+        P v = padd(pmul(b2, ploadu<P>(second + i)), pmul(one_b2, pmul(g, g)));
+        pstoreu(first + i, m);
+        pstoreu(second + i, v);
+        pstoreu(param + i, psub(ploadu<P>(param + i), 
+                    pdiv(pmul(r, m), padd(psqrt(v), eps))));
+    });
+}
+
+template class BasicOptimizer<float>;
+template class BasicSGD<float>;
+template class BasicMomentum<float>;
+template class BasicNesterov<float>;
+template class BasicRMSProp<float>;
+template class BasicAdam<float>;
+template class BasicOptimizer<double>;
+template class BasicSGD<double>;
+template class BasicMomentum<double>;
+template class BasicNesterov<double>;
+template class BasicRMSProp<double>;
+template class BasicAdam<double>;
+
+} // namespace my_nn
@@ -0,0 +1,160 @@
+/*      optimizer.h
+ *
+ *      header file for the Optimizer classes
+ */
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <cstdlib>
+
+#include "layer.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+class BasicModel;
+template <typename Scalar>
+class BasicWorkspace;
+
+/* BasicOptimizer
+ *
+ * Base class of the update rules used by the training. The state of the
+ * rule (moments, velocities) is laid out like the parameters of the model, 
+ * and the whole model is updated in a single vectorized pass over its
+ * parameter buffer, which reads the gradient, updates the state and the 
+ * parameters at once.
+ */
+template <typename Scalar>
+class BasicOptimizer {
+    public:
+        /* `state_slots` is the number of buffers of the size of the 
+         * parameters that the update rule keeps. */
+        BasicOptimizer(Scalar learning_rate, std::size_t state_slots);
+        virtual ~BasicOptimizer() = default;
+
+        Scalar learning_rate() const { return rate; }
+        void set_learning_rate(Scalar learning_rate) { rate = learning_rate; }
+        /* Sizes the state after the layers of `model` and clears it. */
+        void reset(const BasicModel<Scalar> &model);
+        /* Updates the parameters of `model` from the gradients stored in 
+         * `workspace`. The state is reset first if it does not match the 
+         * model, but is otherwise kept between calls. 
+         */
+        void step(BasicModel<Scalar> &model, 
+                const BasicWorkspace<Scalar> &workspace);
+
+    protected:
+        /* Update rule for `size` parameters. `state` points to 
+         * `state_slots` consecutive buffers of `size` elements each.
+         */
+        virtual void update(Scalar *param, const Scalar *grad,
+                Scalar *state, std::size_t size) = 0;
+
+        Scalar rate;
+        // number of steps since the last reset, counting the current one
+        std::size_t steps;
+
+    private:
+        const std::size_t slots;
+        // one column per slot, as long as the parameters of the model
+        MatrixT<Scalar> state;
+};
+
+/* Plain stochastic gradient descent: param -= rate * grad */
+template <typename Scalar>
+class BasicSGD : public BasicOptimizer<Scalar> {
+    public:
+        BasicSGD(Scalar learning_rate)
+            : BasicOptimizer<Scalar>(learning_rate, 0) {}
+    protected:
+        void update(Scalar *param, const Scalar *grad,
+                Scalar *state, std::size_t size) override;
+};
+
+/* Gradient descent with a velocity: v = mu * v - rate * grad; param += v */
+template <typename Scalar>
+class BasicMomentum : public BasicOptimizer<Scalar> {
+    public:
+        BasicMomentum(Scalar learning_rate, Scalar momentum = 0.9)
+            : BasicOptimizer<Scalar>(learning_rate, 1), momentum{momentum} {}
+    protected:
+        void update(Scalar *param, const Scalar *grad,
+                Scalar *state, std::size_t size) override;
+    private:
+        Scalar momentum;
+};
+
+/* Nesterov accelerated gradient, in the form that only needs the gradient at
+ * the current parameters: param += (1 + mu) * v - mu * v_previous 
+ */
+template <typename Scalar>
+class BasicNesterov : public BasicOptimizer<Scalar> {
+    public:
+        BasicNesterov(Scalar learning_rate, Scalar momentum = 0.9)
+            : BasicOptimizer<Scalar>(learning_rate, 1), momentum{momentum} {}
+    protected:
+        void update(Scalar *param, const Scalar *grad,
+                Scalar *state, std::size_t size) override;
+    private:
+        Scalar momentum;
+};
+
+/* RMSProp: scales the step by a running average of the squared gradient. */
+template <typename Scalar>
+class BasicRMSProp : public BasicOptimizer<Scalar> {
+    public:
+        BasicRMSProp(Scalar learning_rate = 0.001, Scalar decay = 0.9,
+                Scalar epsilon = 1e-8)
+            : BasicOptimizer<Scalar>(learning_rate, 1), decay{decay}, 
+            epsilon{epsilon} {}
+    protected:
+        void update(Scalar *param, const Scalar *grad,
+                Scalar *state, std::size_t size) override;
+    private:
+        Scalar decay;
+        Scalar epsilon;
+};
+
+/* Adam: running averages of the gradient and of its square, with bias 
+ * correction. 
+ */
+template <typename Scalar>
+class BasicAdam : public BasicOptimizer<Scalar> {
+    public:
+        BasicAdam(Scalar learning_rate = 0.001, Scalar beta1 = 0.9, 
+                Scalar beta2 = 0.999, Scalar epsilon = 1e-8)
+            : BasicOptimizer<Scalar>(learning_rate, 2), beta1{beta1}, 
+            beta2{beta2}, epsilon{epsilon} {}
+    protected:
+        void update(Scalar *param, const Scalar *grad,
+                Scalar *state, std::size_t size) override;
+    private:
+        Scalar beta1;
+        Scalar beta2;
+        Scalar epsilon;
+};
+
+using Optimizer = BasicOptimizer<elem_type>;
+using SGD = BasicSGD<elem_type>;
+using Momentum = BasicMomentum<elem_type>;
+using Nesterov = BasicNesterov<elem_type>;
+using RMSProp = BasicRMSProp<elem_type>;
+using Adam = BasicAdam<elem_type>;
+
+extern template class BasicOptimizer<float>;
+extern template class BasicSGD<float>;
+extern template class BasicMomentum<float>;
+extern template class BasicNesterov<float>;
+extern template class BasicRMSProp<float>;
+extern template class BasicAdam<float>;
+extern template class BasicOptimizer<double>;
+extern template class BasicSGD<double>;
+extern template class BasicMomentum<double>;
+extern template class BasicNesterov<double>;
+extern template class BasicRMSProp<double>;
+extern template class BasicAdam<double>;
+
+} // namespace my_nn
+
+#endif // OPTIMIZER_H
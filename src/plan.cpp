@@ -0,0 +1,282 @@
+/*      plan.cpp
+ *
+ *      implementation file for the InferencePlan class
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include "activation.h"
+#include "inference.h"
+#include "layer.h"
+#include "model.h"
+#include "plan.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+BasicInferencePlan<Scalar>::BasicInferencePlan(const BasicModel<Scalar> &model)
+    : input_size{model.input()}, steps{}
+{
+    for (std::size_t i = 0; i < model.layer_number(); i++) {
+        auto &layer = model.get_layer(i);
+        steps.push_back({layer.weights(), layer.bias(), layer.activation(),
+                &layer.kernels(), {}, false});
+    }
+    simplify();
+}
+
+template <typename Scalar>
+BasicInferencePlan<Scalar>::BasicInferencePlan(const BasicModel<Scalar> &model,
+        const Vector &mean, const Vector &scale)
+    : input_size{model.input()}, steps{}
+{
+    if (static_cast<std::size_t>(mean.size()) != input_size || 
+            static_cast<std::size_t>(scale.size()) != input_size) {
+        throw std::invalid_argument("Normalization does not fit the model");
+    }
+    // the normalization is the affine step diag(scale) x - scale * mean
+    steps.push_back({scale.asDiagonal(), -scale.cwiseProduct(mean), 
+            Activation::None, &activation_kernels<Scalar>(Activation::None), 
+            {}, false});
+    for (std::size_t i = 0; i < model.layer_number(); i++) {
+        auto &layer = model.get_layer(i);
+        steps.push_back({layer.weights(), layer.bias(), layer.activation(),
+                &layer.kernels(), {}, false});
+    }
+    simplify();
+}
+
+template <typename Scalar>
+void BasicInferencePlan<Scalar>::simplify() {
+    std::vector<Step> result;
+    for (auto &step : steps) {
+        // an identity step changes nothing
+        if (step.activation == Activation::None && 
+                step.weights.rows() == step.weights.cols() &&
+                step.weights.isIdentity(0) && step.bias.isZero(0)) {
+            continue;
+        }
+        if (result.size() > 0 && result.back().activation == Activation::None) {
+            // W (V x + c) + b = (W V) x + (W c + b), cheaper if W V is 
+            // smaller than W and V together, i.e. unless the affine step
+            // is a bottleneck
+            auto &previous = result.back();
+            const std::size_t fused = step.weights.rows() * 
+                previous.weights.cols();
+            const std::size_t separate = step.weights.size() + 
+                previous.weights.size();
+            if (fused <= separate) {
+                previous.bias = step.weights * previous.bias + step.bias;
+                previous.weights = step.weights * previous.weights;
+                previous.activation = step.activation;
+                previous.kernels = step.kernels;
+                continue;
+            }
+        }
+        result.push_back(std::move(step));
+    }
+    steps = std::move(result);
+}
+
+template <typename Scalar>
+std::size_t BasicInferencePlan<Scalar>::cost() const {
+    std::size_t cost = 0;
+    for (auto &step : steps) {
+        cost += step.sparse ? step.sparse_weights.nonZeros() : 
+            step.weights.size();
+    }
+    return cost;
+}
+
+template <typename Scalar>
+std::size_t BasicInferencePlan<Scalar>::parameter_bytes() const {
+    using Index = typename SparseMatrix::StorageIndex;
+    std::size_t bytes = 0;
+    for (auto &step : steps) {
+        bytes += step.bias.size() * sizeof(Scalar);
+        if (step.sparse) {
+            // a value and a column index per nonzero, and the row starts
+            bytes += step.sparse_weights.nonZeros() * 
+                (sizeof(Scalar) + sizeof(Index)) + 
+                (step.sparse_weights.rows() + 1) * sizeof(Index);
+        } else {
+            bytes += step.weights.size() * sizeof(Scalar);
+        }
+    }
+    return bytes;
+}
+
+namespace {
+
+/* Writes in `out` the product of the weights of `step` with `inputs`. */
+template <typename Step, typename Inputs, typename Outputs>
+void apply_weights(const Step &step, const Inputs &inputs, Outputs &&out) {
+    if (step.sparse) {
+        out.noalias() = step.sparse_weights * inputs;
+    } else {
+        out.noalias() = step.weights * inputs;
+    }
+}
+
+/* The lowest rank whose discarded `masses`, one per singular value by 
+ * decreasing value, sum up to at most `budget`; at least 1. */
+template <typename Scalar>
+Eigen::Index truncation_rank(const VectorT<Scalar> &masses, Scalar budget) {
+    Scalar discarded = 0;
+    Eigen::Index rank = masses.size();
+    while (rank > 1 && discarded + masses(rank - 1) <= budget) {
+        discarded += masses(rank - 1);
+        rank--;
+    }
+    return rank;
+}
+
+/* Appends `step` to `steps`, as its rank `rank` factors from `svd` if they
+ * are cheaper to apply than its weights. */
+template <typename Scalar, typename Step>
+void append_factors(std::vector<Step> &steps, Step &&step, 
+        const Eigen::BDCSVD<MatrixT<Scalar>> &svd, Eigen::Index rank) {
+    const Eigen::Index rows = step.weights.rows();
+    const Eigen::Index cols = step.weights.cols();
+    if (rank * (rows + cols) >= rows * cols) {
+        steps.push_back(std::move(step));
+        return;
+    }
+    steps.push_back({svd.singularValues().head(rank).asDiagonal() * 
+            svd.matrixV().leftCols(rank).transpose(), 
+            VectorT<Scalar>::Zero(rank), Activation::None, 
+            &activation_kernels<Scalar>(Activation::None), {}, false});
+    step.weights = svd.matrixU().leftCols(rank);
+    steps.push_back(std::move(step));
+}
+
+} // namespace
+
+template <typename Scalar>
+void BasicInferencePlan<Scalar>::compress(Scalar energy) {
+    if (!(energy > 0 && energy <= 1)) {
+        throw std::invalid_argument("Energy must be in (0, 1]");
+    }
+    std::vector<Step> result;
+    for (auto &step : steps) {
+        if (step.sparse) {
+            result.push_back(std::move(step));
+            continue;
+        }
+        Eigen::BDCSVD<Matrix> svd(step.weights, 
+                Eigen::ComputeThinU | Eigen::ComputeThinV);
+        Vector masses = svd.singularValues().array().square();
+        const Scalar budget = (1 - energy) * masses.sum();
+        append_factors(result, std::move(step), svd, 
+                truncation_rank<Scalar>(masses, budget));
+    }
+    steps = std::move(result);
+}
+
+template <typename Scalar>
+void BasicInferencePlan<Scalar>::compress(const Matrix &calibration, 
+        Scalar tolerance) {
+    if (static_cast<std::size_t>(calibration.rows()) != input_size) {
+        throw std::invalid_argument("Calibration does not fit the plan");
+    }
+    if (!(tolerance >= 0)) {
+        throw std::invalid_argument("Tolerance must be positive");
+    }
+    std::vector<Step> result;
+    Matrix inputs = calibration;
+    for (auto &step : steps) {
+        const std::size_t first = result.size();
+        if (step.sparse) {
+            result.push_back(std::move(step));
+        } else {
+            Eigen::BDCSVD<Matrix> svd(step.weights, 
+                    Eigen::ComputeThinU | Eigen::ComputeThinV);
+            // U has orthonormal columns, so dropping the singular values 
+            // from k on leaves an error of squared norm 
+            // sum_i s_i^2 |v_i^T inputs|^2
+            Vector masses = svd.singularValues().array().square() * 
+                (svd.matrixV().transpose() * inputs).rowwise().squaredNorm()
+                .array();
+            const Scalar budget = tolerance * tolerance * 
+                (step.weights * inputs).squaredNorm();
+            append_factors(result, std::move(step), svd, 
+                    truncation_rank<Scalar>(masses, budget));
+        }
+        // the next step gets the outputs of the compressed one
+        for (std::size_t i = first; i < result.size(); i++) {
+            Matrix outputs(result[i].nodes(), inputs.cols());
+            apply_weights(result[i], inputs, outputs);
+            result[i].kernels->forward(outputs, result[i].bias);
+            inputs.swap(outputs);
+        }
+    }
+    steps = std::move(result);
+}
+
+template <typename Scalar>
+void BasicInferencePlan<Scalar>::sparsify(Scalar density) {
+    for (auto &step : steps) {
+        if (step.sparse) {
+            continue;
+        }
+        const auto nonzeros = (step.weights.array() != Scalar(0)).count();
+        if (nonzeros <= density * step.weights.size()) {
+            step.sparse_weights = step.weights.sparseView();
+            step.sparse_weights.makeCompressed();
+            step.weights.resize(0, 0);
+            step.sparse = true;
+        }
+    }
+}
+
+template <typename Scalar>
+auto BasicInferencePlan<Scalar>::operator()(const Vector &input) const 
+    -> Vector
+{
+    InferenceContext context(*this);
+    return forward(input, context).col(0);
+}
+
+template <typename Scalar>
+auto BasicInferencePlan<Scalar>::forward(const Matrix &inputs) const -> Matrix
+{
+    InferenceContext context(*this, std::max<Eigen::Index>(inputs.cols(), 1));
+    return forward(inputs, context);
+}
+
+template <typename Scalar>
+auto BasicInferencePlan<Scalar>::forward(const Eigen::Ref<const Matrix> &inputs,
+        InferenceContext &context) const -> Eigen::Ref<const Matrix>
+{
+    if (static_cast<std::size_t>(inputs.rows()) != input_size) {
+        throw std::invalid_argument("Inputs do not fit the plan");
+    }
+    const std::size_t cols = inputs.cols();
+    if (steps.size() == 0) {
+        context.check(input_size, cols);
+        auto out = context.output(0, input_size, cols);
+        out = inputs;
+        return out;
+    }
+    for (std::size_t i = 0; i < steps.size(); i++) {
+        auto &step = steps[i];
+        context.check(step.nodes(), cols);
+        auto out = context.output(i, step.nodes(), cols);
+        if (i == 0) {
+            apply_weights(step, inputs, out);
+        } else {
+            apply_weights(step, 
+                    context.output(i - 1, steps[i - 1].nodes(), cols), out);
+        }
+        step.kernels->forward(out, step.bias);
+    }
+    return context.output(steps.size() - 1, steps.back().nodes(), cols);
+}
+
+template class BasicInferencePlan<float>;
+template class BasicInferencePlan<double>;
+
+} // namespace my_nn
@@ -0,0 +1,115 @@
+/*      plan.h
+ *
+ *      header file for the InferencePlan class
+ */
+
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <cstdlib>
+#include <vector>
+
+#include "Eigen/Sparse"
+
+#include "activation.h"
+#include "inference.h"
+#include "layer.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+class BasicModel;
+
+/* BasicInferencePlan
+ *
+ * A model frozen for inference: the sequence of affine maps and activations
+ * to apply, simplified once so that applying it does the fewest products.
+ * An affine step (no activation) is folded into the next one when the 
+ * product of their weights is cheaper to apply than both, identity steps 
+ * are dropped, and a constant normalization of the inputs can be folded
+ * into the first step. The plan copies the parameters it needs, so it does
+ * not depend on the model afterwards.
+ * The plan can also be compressed: the weights W of a step are replaced by
+ * a truncated SVD U (S V^T), applied as an affine step S V^T to a 
+ * bottleneck of k nodes followed by the step with weights U. This is the
+ * opposite of the folding, so compression is applied last.
+ * The weights of the steps that are mostly zeros, e.g. after Model::prune,
+ * can then be stored as row-major sparse matrices, applied with 
+ * sparse-dense products.
+ */
+template <typename Scalar>
+class BasicInferencePlan {
+    public:
+        using Matrix = MatrixT<Scalar>;
+        using Vector = VectorT<Scalar>;
+        using InferenceContext = BasicInferenceContext<Scalar>;
+
+        using SparseMatrix = Eigen::SparseMatrix<Scalar, Eigen::RowMajor>;
+
+        struct Step {
+            Matrix weights;  // empty when the step is sparse
+            Vector bias;
+            Activation activation;
+            const ActivationKernels<Scalar> *kernels;
+            SparseMatrix sparse_weights;  // the weights of a sparse step
+            bool sparse;
+
+            std::size_t nodes() const { return bias.size(); }
+        };
+
+        /* Freezes `model`, see Model::freeze. */
+        explicit BasicInferencePlan(const BasicModel<Scalar> &model);
+        /* Same, for inputs normalized as (input - mean) * scale, 
+         * coefficient-wise, before the model: the plan takes the raw 
+         * inputs. */
+        BasicInferencePlan(const BasicModel<Scalar> &model, 
+                const Vector &mean, const Vector &scale);
+
+        /* Apply the plan to some input */
+        Vector operator()(const Vector &input) const;
+        /* Apply the plan to a batch of inputs, one sample per column. */
+        Matrix forward(const Matrix &inputs) const;
+        /* Same, in the buffers of `context`. The result is a view into the
+         * context, valid until its next use. */
+        Eigen::Ref<const Matrix> forward(const Eigen::Ref<const Matrix> &inputs,
+                InferenceContext &context) const;
+
+        std::size_t input() const { return input_size; }
+        std::size_t step_number() const { return steps.size(); }
+        const Step &get_step(std::size_t index) const { return steps[index]; }
+        /* The multiply-adds to apply the plan to one input. */
+        std::size_t cost() const;
+        /* The memory taken by the weights and biases of the steps. */
+        std::size_t parameter_bytes() const;
+
+        /* Compresses each step to the lowest rank keeping at least 
+         * `energy` (in (0, 1]) of the squared norm of its weights, if its
+         * factors are cheaper to apply than its weights. */
+        void compress(Scalar energy);
+        /* Same, with the lowest rank keeping the relative error of the 
+         * pre-activations of each step within `tolerance`, on the 
+         * `calibration` inputs (one per column) as they reach the step 
+         * through the compressed plan. */
+        void compress(const Matrix &calibration, Scalar tolerance);
+        /* Stores the weights of each step with at most a fraction `density`
+         * of nonzero weights as a sparse matrix. The default is about the
+         * density below which the sparse products get faster than the dense
+         * ones (BM_PlanSparse). Sparse steps are not compressed. */
+        void sparsify(Scalar density = Scalar(0.25));
+
+    private:
+        /* Folds and drops the steps, see above. */
+        void simplify();
+
+        std::size_t input_size;
+        std::vector<Step> steps;
+};
+
+using InferencePlan = BasicInferencePlan<elem_type>;
+
+extern template class BasicInferencePlan<float>;
+extern template class BasicInferencePlan<double>;
+
+} // namespace my_nn
+
+#endif // PLAN_H
@@ -0,0 +1,107 @@
+/*      prefetcher.cpp
+ *
+ *      implementation file for the Prefetcher class
+ */
+
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "prefetcher.h"
+#include "sampler.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+BasicPrefetcher<Scalar>::BasicPrefetcher(std::size_t feature_size, 
+        std::size_t label_size, std::size_t batch_size, Sampler sampler, 
+        Gather gather, Transform transform)
+    : batch_size_p{batch_size}, gather{std::move(gather)},
+    transform{std::move(transform)}, sampler{std::move(sampler)}, 
+    indices(batch_size),
+    buffers{{Matrix(feature_size, batch_size), Matrix(label_size, batch_size)},
+        {Matrix(feature_size, batch_size), Matrix(label_size, batch_size)}},
+    states{State::Free, State::Free}, current{0}, stopping{false}, error{}
+{
+    if (batch_size == 0) {
+        throw std::invalid_argument("Empty mini-batches");
+    }
+    worker = std::thread(&BasicPrefetcher::work, this);
+}
+
+template <typename Scalar>
+BasicPrefetcher<Scalar>::~BasicPrefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+template <typename Scalar>
+auto BasicPrefetcher<Scalar>::next() -> const Batch & {
+    std::unique_lock<std::mutex> lock(mutex);
+    // the batch returned last time is done with
+    auto previous = current ^ 1;
+    if (states[previous] == State::Used) {
+        states[previous] = State::Free;
+        changed.notify_all();
+    }
+    changed.wait(lock, [this] { 
+        return states[current] == State::Ready || error; 
+    });
+    if (states[current] != State::Ready) {
+        std::rethrow_exception(error);
+    }
+    states[current] = State::Used;
+    auto &batch = buffers[current];
+    current ^= 1;
+    return batch;
+}
+
+template <typename Scalar>
+void BasicPrefetcher<Scalar>::work() {
+    std::size_t fill = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this, fill] { 
+                return states[fill] == State::Free || stopping; 
+            });
+            if (stopping) {
+                return;
+            }
+        }
+        // the buffer is not shared while it is free
+        try {
+            for (auto &index : indices) {
+                index = sampler.next();
+            }
+            gather(indices, buffers[fill]);
+            if (transform) {
+                transform(buffers[fill].features, buffers[fill].labels);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            error = std::current_exception();
+            changed.notify_all();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            states[fill] = State::Ready;
+        }
+        changed.notify_all();
+        fill ^= 1;
+    }
+}
+
+template class BasicPrefetcher<float>;
+template class BasicPrefetcher<double>;
+
+} // namespace my_nn
@@ -0,0 +1,130 @@
+/*      prefetcher.h
+ *
+ *      header file for the Prefetcher class
+ */
+
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "dataset.h"
+#include "layer.h"
+#include "sampler.h"
+
+namespace my_nn {
+
+/* BasicPrefetcher
+ *
+ * Assembles mini-batches on a background thread, so that gathering the
+ * instances, converting them to the scalar type of the model and transforming
+ * them (e.g. normalizing) overlaps the training step on the previous batch.
+ * There are two batch buffers: the thread fills one while the training reads
+ * the other, then they swap.
+ *
+ * The instances are visited in the order of a Sampler; by default, the same 
+ * as Model::train, so that training from a prefetcher gives the same model.
+ */
+template <typename Scalar>
+class BasicPrefetcher {
+    public:
+        using Matrix = MatrixT<Scalar>;
+        /* Applied to each mini-batch, one instance per column, on the 
+         * background thread. */
+        using Transform = std::function<void(Eigen::Ref<Matrix> features, 
+                Eigen::Ref<Matrix> labels)>;
+
+        struct Batch {
+            Matrix features;
+            Matrix labels;
+        };
+
+        /* Prefetches mini-batches of `batch_size` instances of `data`, 
+         * which must outlive the prefetcher. The instances may have another
+         * scalar type, e.g. float on disk and double in the model. */
+        template <typename Source>
+        BasicPrefetcher(const BasicDatasetView<Source> &data, 
+                std::size_t batch_size, Transform transform = {});
+        /* Same, drawing the instances from `sampler`. */
+        template <typename Source>
+        BasicPrefetcher(const BasicDatasetView<Source> &data, 
+                std::size_t batch_size, Sampler sampler, 
+                Transform transform = {});
+        ~BasicPrefetcher();
+        BasicPrefetcher(const BasicPrefetcher &other) = delete;
+        BasicPrefetcher &operator=(const BasicPrefetcher &other) = delete;
+
+        /* Number of instances in the dataset. */
+        std::size_t size() const { return sampler.size(); }
+        std::size_t batch_size() const { return batch_size_p; }
+        std::size_t feature_size() const { return buffers[0].features.rows(); }
+        std::size_t label_size() const { return buffers[0].labels.rows(); }
+        /* Waits for the next mini-batch. It stays valid until the following
+         * call, when its buffer goes back to the background thread. If
+         * the transform threw, the exception is rethrown here. */
+        const Batch &next();
+
+    private:
+        // copies the instances of the given indices into the batch
+        using Gather = std::function<void(const std::vector<std::size_t> &, 
+                Batch &)>;
+        enum class State { Free, Ready, Used };
+
+        BasicPrefetcher(std::size_t feature_size, std::size_t label_size, 
+                std::size_t batch_size, Sampler sampler, Gather gather, 
+                Transform transform);
+        void work();
+
+        std::size_t batch_size_p;
+        Gather gather;
+        Transform transform;
+        Sampler sampler;
+        std::vector<std::size_t> indices;
+        Batch buffers[2];
+        State states[2];
+        // the buffer that next() returns next
+        std::size_t current;
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool stopping;
+        std::exception_ptr error;
+        std::thread worker;
+};
+
+template <typename Scalar>
+template <typename Source>
+BasicPrefetcher<Scalar>::BasicPrefetcher(const BasicDatasetView<Source> &data,
+        std::size_t batch_size, Transform transform)
+    : BasicPrefetcher(data, batch_size, Sampler(data.size()), 
+            std::move(transform)) {}
+
+template <typename Scalar>
+template <typename Source>
+BasicPrefetcher<Scalar>::BasicPrefetcher(const BasicDatasetView<Source> &data,
+        std::size_t batch_size, Sampler sampler, Transform transform)
+    : BasicPrefetcher(data.feature_size(), data.label_size(), batch_size, 
+            std::move(sampler),
+            [data](const std::vector<std::size_t> &indices, Batch &batch) {
+                for (std::size_t b = 0; b < indices.size(); b++) {
+                    batch.features.col(b) = data.features().col(indices[b])
+                        .template cast<Scalar>();
+                    batch.labels.col(b) = data.labels().col(indices[b])
+                        .template cast<Scalar>();
+                }
+            }, std::move(transform)) {}
+
+using Prefetcher = BasicPrefetcher<elem_type>;
+
+extern template class BasicPrefetcher<float>;
+extern template class BasicPrefetcher<double>;
+
+} // namespace my_nn
+
+#endif // PREFETCHER_H
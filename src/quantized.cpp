@@ -0,0 +1,219 @@
+/*      quantized.cpp
+ *
+ *      implementation file for the QuantizedModel class
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "activation.h"
+#include "layer.h"
+#include "model.h"
+#include "quantized.h"
+
+namespace my_nn {
+
+namespace {
+
+// symmetric quantization: -128 is left out so that negating is exact
+const int int8_limit = 127;
+
+// quantized inputs, one sample per column. The values are those of int8, 
+// held in int16: int8 weights times int16 inputs summed in int32 is the 
+// pattern the compiler turns into pmaddwd (vpdpwssd with AVX-VNNI), whereas 
+// int8 times int8 widens each operand separately.
+using QuantizedColumns = Eigen::Matrix<std::int16_t, Eigen::Dynamic, 
+      Eigen::Dynamic>;
+
+/* Rounds half away from zero, inline: std::nearbyint is a library call 
+ * without SSE4.1, and would dominate the requantization. */
+template <typename Scalar>
+std::int16_t quantize(Scalar x, Scalar inverse_scale) {
+    Scalar q = x * inverse_scale;
+    q = std::min(std::max(q, Scalar(-int8_limit)), Scalar(int8_limit));
+    return static_cast<std::int16_t>(q + std::copysign(Scalar(0.5), q));
+}
+
+/* The scale mapping [-range, range] to the int8 values. */
+template <typename Scalar>
+Scalar scale_of(Scalar range) {
+    return range > Scalar(0) ? range / Scalar(int8_limit) : Scalar(1);
+}
+
+/* acc = weights * inputs, with the products summed in int32. Four columns of
+ * inputs are done at once, so that each row of weights is read once for four
+ * of them. The inner loops are plain loops over contiguous integers, which 
+ * the compiler vectorizes into multiply-adds. */
+template <typename Int8Matrix, typename Int32Matrix>
+void int8_product(const Int8Matrix &weights, const QuantizedColumns &inputs,
+        Int32Matrix &acc) {
+    const std::size_t rows = weights.rows();
+    const std::size_t depth = weights.cols();
+    const std::size_t cols = inputs.cols();
+    std::size_t c = 0;
+    for (; c + 4 <= cols; c += 4) {
+        const std::int16_t *x0 = inputs.col(c).data();
+        const std::int16_t *x1 = inputs.col(c + 1).data();
+        const std::int16_t *x2 = inputs.col(c + 2).data();
+        const std::int16_t *x3 = inputs.col(c + 3).data();
+        for (std::size_t r = 0; r < rows; r++) {
+            const std::int8_t *w = weights.data() + r * depth;
+            std::int32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            for (std::size_t k = 0; k < depth; k++) {
+                const std::int16_t wk = w[k];
+                s0 += wk * x0[k];
+                s1 += wk * x1[k];
+                s2 += wk * x2[k];
+                s3 += wk * x3[k];
+            }
+            acc(r, c) = s0;
+            acc(r, c + 1) = s1;
+            acc(r, c + 2) = s2;
+            acc(r, c + 3) = s3;
+        }
+    }
+    for (; c < cols; c++) {
+        const std::int16_t *x = inputs.col(c).data();
+        for (std::size_t r = 0; r < rows; r++) {
+            const std::int8_t *w = weights.data() + r * depth;
+            std::int32_t s = 0;
+            for (std::size_t k = 0; k < depth; k++) {
+                s += static_cast<std::int16_t>(w[k]) * x[k];
+            }
+            acc(r, c) = s;
+        }
+    }
+}
+
+} // namespace
+
+template <typename Scalar>
+BasicQuantizedModel<Scalar>::BasicQuantizedModel(
+        const BasicModel<Scalar> &model, 
+        const Eigen::Ref<const Matrix> &calibration)
+    : input_size{model.input()}, layers{}
+{
+    if (static_cast<std::size_t>(calibration.rows()) != input_size ||
+            calibration.cols() == 0) {
+        throw std::invalid_argument("Calibration inputs do not fit the model");
+    }
+    Matrix activations = calibration;
+    layers.reserve(model.layer_number());
+    for (std::size_t i = 0; i < model.layer_number(); i++) {
+        auto &layer = model.get_layer(i);
+        QuantizedLayer quantized;
+        quantized.row_scales = layer.weights().rowwise().template lpNorm<
+            Eigen::Infinity>().unaryExpr([](Scalar range) { 
+                    return scale_of(range); 
+            });
+        quantized.weights.resize(layer.nodes(), layer.weights().cols());
+        for (Eigen::Index r = 0; r < quantized.weights.rows(); r++) {
+            const Scalar inverse = Scalar(1) / quantized.row_scales(r);
+            for (Eigen::Index k = 0; k < quantized.weights.cols(); k++) {
+                quantized.weights(r, k) = static_cast<std::int8_t>(
+                        quantize(layer.weights()(r, k), inverse));
+            }
+        }
+        quantized.bias = layer.bias();
+        quantized.input_scale = scale_of(activations.template lpNorm<
+                Eigen::Infinity>());
+        quantized.output_scales = quantized.row_scales * quantized.input_scale;
+        quantized.activation = layer.activation();
+        quantized.kernels = &layer.kernels();
+        layers.push_back(std::move(quantized));
+        activations = layer.forward(activations);
+    }
+}
+
+template <typename Scalar>
+std::size_t BasicQuantizedModel<Scalar>::parameter_bytes() const {
+    std::size_t bytes = 0;
+    for (auto &layer : layers) {
+        bytes += layer.weights.size() * sizeof(std::int8_t) + 
+            (layer.row_scales.size() + layer.bias.size()) * sizeof(Scalar);
+    }
+    return bytes;
+}
+
+template <typename Scalar>
+auto BasicQuantizedModel<Scalar>::operator()(const Vector &input) const 
+    -> Vector
+{
+    return forward(input);
+}
+
+template <typename Scalar>
+auto BasicQuantizedModel<Scalar>::forward(
+        const Eigen::Ref<const Matrix> &inputs) const -> Matrix
+{
+    if (static_cast<std::size_t>(inputs.rows()) != input_size) {
+        throw std::invalid_argument("Inputs do not fit the model");
+    }
+    if (layers.size() == 0) {
+        return inputs;
+    }
+    const Eigen::Index cols = inputs.cols();
+    QuantizedColumns quantized(input_size, cols);
+    const Scalar inverse = Scalar(1) / layers[0].input_scale;
+    for (Eigen::Index c = 0; c < cols; c++) {
+        for (Eigen::Index r = 0; r < inputs.rows(); r++) {
+            quantized(r, c) = quantize(inputs(r, c), inverse);
+        }
+    }
+    Int32Matrix acc;
+    QuantizedColumns next;
+    for (std::size_t i = 0; i + 1 < layers.size(); i++) {
+        auto &layer = layers[i];
+        const Eigen::Index nodes = layer.weights.rows();
+        const Scalar next_inverse = Scalar(1) / layers[i + 1].input_scale;
+        acc.resize(nodes, cols);
+        int8_product(layer.weights, quantized, acc);
+        if (layer.activation == Activation::None || 
+                layer.activation == Activation::ReLU) {
+            // scale, add the bias, activate and requantize in one pass
+            const bool relu = layer.activation == Activation::ReLU;
+            next.resize(nodes, cols);
+            for (Eigen::Index c = 0; c < cols; c++) {
+                for (Eigen::Index r = 0; r < nodes; r++) {
+                    Scalar y = acc(r, c) * layer.output_scales(r) + 
+                        layer.bias(r);
+                    if (relu && y < Scalar(0)) {
+                        y = Scalar(0);
+                    }
+                    next(r, c) = quantize(y, next_inverse);
+                }
+            }
+        } else {
+            // the other activations go through their floating-point kernels
+            next = dequantize(layer, acc).unaryExpr([next_inverse](Scalar y) {
+                return quantize(y, next_inverse); 
+            });
+        }
+        quantized.swap(next);
+    }
+    auto &last = layers.back();
+    acc.resize(last.weights.rows(), cols);
+    int8_product(last.weights, quantized, acc);
+    return dequantize(last, acc);
+}
+
+template <typename Scalar>
+auto BasicQuantizedModel<Scalar>::dequantize(const QuantizedLayer &layer,
+        const Int32Matrix &acc) -> Matrix
+{
+    Matrix outputs = (acc.template cast<Scalar>().array().colwise() *
+        layer.output_scales.array()).matrix();
+    layer.kernels->forward(outputs, layer.bias);
+    return outputs;
+}
+
+template class BasicQuantizedModel<float>;
+template class BasicQuantizedModel<double>;
+
+} // namespace my_nn
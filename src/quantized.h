@@ -0,0 +1,89 @@
+/*      quantized.h
+ *
+ *      header file for the QuantizedModel class
+ */
+
+#ifndef QUANTIZED_H
+#define QUANTIZED_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "Eigen/Dense"
+
+#include "activation.h"
+#include "layer.h"
+#include "model.h"
+
+namespace my_nn {
+
+/* BasicQuantizedModel
+ *
+ * A trained model converted for inference in 8-bit integers. Each row of the
+ * weights of a layer is stored as int8 with its own scale, and the input of
+ * each layer is quantized to int8 with one scale per layer, calibrated on 
+ * sample inputs. The products accumulate in int32; the accumulators are then
+ * scaled, biased and activated, and, except for the last layer, requantized 
+ * for the next layer in the same pass. The weights take an eighth of their
+ * size in double; the outputs differ from those of the model by the rounding
+ * to 8 bits of the weights and of the activations.
+ */
+template <typename Scalar>
+class BasicQuantizedModel {
+    public:
+        using Matrix = MatrixT<Scalar>;
+        using Vector = VectorT<Scalar>;
+        // row-major so that the rows multiply contiguous input columns
+        using Int8Matrix = Eigen::Matrix<std::int8_t, Eigen::Dynamic, 
+              Eigen::Dynamic, Eigen::RowMajor>;
+        using Int32Matrix = Eigen::Matrix<std::int32_t, Eigen::Dynamic, 
+              Eigen::Dynamic>;
+
+        /* Quantizes `model`. `calibration` holds typical inputs, one per
+         * column: the range of the input of each layer over them sets its
+         * scale, and larger values are clamped. */
+        BasicQuantizedModel(const BasicModel<Scalar> &model, 
+                const Eigen::Ref<const Matrix> &calibration);
+
+        /* Apply the model to some input */
+        Vector operator()(const Vector &input) const;
+        /* Apply the model to a batch of inputs, one sample per column. */
+        Matrix forward(const Eigen::Ref<const Matrix> &inputs) const;
+
+        std::size_t layer_number() const { return layers.size(); }
+        std::size_t input() const { return input_size; }
+        /* The size of the quantized parameters, in bytes. */
+        std::size_t parameter_bytes() const;
+
+    private:
+        struct QuantizedLayer {
+            Int8Matrix weights;
+            // the weights of row r are weights.row(r) * row_scales(r)
+            Vector row_scales;
+            Vector bias;
+            // the input is the int8 input times input_scale
+            Scalar input_scale;
+            // row_scales * input_scale: from the accumulators to the outputs
+            Vector output_scales;
+            Activation activation;
+            const ActivationKernels<Scalar> *kernels;
+        };
+
+        /* The outputs of `layer` from its accumulators, biased and
+         * activated. */
+        static Matrix dequantize(const QuantizedLayer &layer, 
+                const Int32Matrix &acc);
+
+        std::size_t input_size;
+        std::vector<QuantizedLayer> layers;
+};
+
+using QuantizedModel = BasicQuantizedModel<elem_type>;
+
+extern template class BasicQuantizedModel<float>;
+extern template class BasicQuantizedModel<double>;
+
+} // namespace my_nn
+
+#endif // QUANTIZED_H
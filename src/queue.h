@@ -0,0 +1,129 @@
+/*      queue.h
+ *
+ *      header file for the BoundedQueue class
+ */
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace my_nn {
+
+/* BoundedQueue
+ *
+ * A lock-free queue of fixed capacity for any number of producers and 
+ * consumers (D. Vyukov's bounded MPMC queue). Each cell carries a sequence
+ * number telling whether it is ready to be written or read at a given 
+ * position, so that pushing or popping is one compare-and-swap on the 
+ * position, and producers and consumers only meet on the cells they share.
+ */
+template <typename T>
+class BoundedQueue {
+    public:
+        /* `capacity` is rounded up to a power of two. */
+        explicit BoundedQueue(std::size_t capacity)
+            : mask{round_up(capacity) - 1}, 
+            cells{new Cell[mask + 1]}, enqueue_position{0}, 
+            dequeue_position{0}
+        {
+            for (std::size_t i = 0; i <= mask; i++) {
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+        BoundedQueue(const BoundedQueue &other) = delete;
+        BoundedQueue &operator=(const BoundedQueue &other) = delete;
+
+        std::size_t capacity() const { return mask + 1; }
+
+        /* Moves `value` into the queue; returns false if it is full. */
+        bool push(T &&value) {
+            Cell *cell;
+            std::size_t position = 
+                enqueue_position.load(std::memory_order_relaxed);
+            while (true) {
+                cell = &cells[position & mask];
+                std::size_t sequence = 
+                    cell->sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::intptr_t>(sequence) - 
+                    static_cast<std::intptr_t>(position);
+                if (difference == 0) {
+                    // the cell is free at this position: claim it
+                    if (enqueue_position.compare_exchange_weak(position, 
+                                position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    // the cell still holds the value of the previous lap
+                    return false;
+                } else {
+                    position = enqueue_position.load(std::memory_order_relaxed);
+                }
+            }
+            cell->value = std::move(value);
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        /* Moves the oldest value into `value`; returns false if the queue 
+         * is empty. */
+        bool pop(T &value) {
+            Cell *cell;
+            std::size_t position = 
+                dequeue_position.load(std::memory_order_relaxed);
+            while (true) {
+                cell = &cells[position & mask];
+                std::size_t sequence = 
+                    cell->sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::intptr_t>(sequence) - 
+                    static_cast<std::intptr_t>(position + 1);
+                if (difference == 0) {
+                    if (dequeue_position.compare_exchange_weak(position, 
+                                position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = dequeue_position.load(std::memory_order_relaxed);
+                }
+            }
+            value = std::move(cell->value);
+            // free for the push one lap later
+            cell->sequence.store(position + mask + 1, 
+                    std::memory_order_release);
+            return true;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        static std::size_t round_up(std::size_t capacity) {
+            if (capacity == 0) {
+                throw std::invalid_argument("Capacity must be positive");
+            }
+            std::size_t power = 1;
+            while (power < capacity) {
+                power *= 2;
+            }
+            return power;
+        }
+
+        const std::size_t mask;
+        std::unique_ptr<Cell[]> cells;
+        // on separate cache lines, as producers and consumers update them
+        alignas(64) std::atomic<std::size_t> enqueue_position;
+        alignas(64) std::atomic<std::size_t> dequeue_position;
+};
+
+} // namespace my_nn
+
+#endif // QUEUE_H
@@ -0,0 +1,61 @@
+/*      sampler.cpp
+ *
+ *      implementation file for the Sampler class
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "sampler.h"
+
+namespace my_nn {
+
+Sampler::Sampler(std::size_t size, Sampling sampling, Seed seed, 
+        std::size_t block_size)
+    : size_p{size}, sampling_p{sampling}, seed{seed}, 
+    block_size{sampling == Sampling::Permutation ? 1 : block_size},
+    generator{}, distribution{}, blocks{}, block{0}, position{0}, end{0}
+{
+    if (size == 0) {
+        throw std::invalid_argument("No instances");
+    }
+    if (this->block_size == 0) {
+        throw std::invalid_argument("Empty blocks");
+    }
+    if (sampling != Sampling::Uniform) {
+        blocks.resize((size + this->block_size - 1) / this->block_size);
+    }
+    reset();
+}
+
+void Sampler::reset() {
+    generator.seed(seed);
+    distribution = std::uniform_int_distribution<std::size_t>(0, size_p - 1);
+    // the blocks are shuffled in place, from the same order each time
+    for (std::size_t i = 0; i < blocks.size(); i++) {
+        blocks[i] = i * block_size;
+    }
+    // the first draw starts an epoch
+    block = blocks.size();
+    position = end = 0;
+}
+
+std::size_t Sampler::next() {
+    if (sampling_p == Sampling::Uniform) {
+        return distribution(generator);
+    }
+    if (position == end) {
+        if (block == blocks.size()) {
+            std::shuffle(blocks.begin(), blocks.end(), generator);
+            block = 0;
+        }
+        position = blocks[block++];
+        end = std::min(position + block_size, size_p);
+    }
+    return position++;
+}
+
+} // namespace my_nn
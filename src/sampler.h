@@ -0,0 +1,69 @@
+/*      sampler.h
+ *
+ *      header file for the Sampler class
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace my_nn {
+
+enum class Sampling {
+    // independent draws with replacement: repeats and misses in an epoch
+    Uniform,
+    // each epoch visits every instance once, in a new random order
+    Permutation,
+    // each epoch visits blocks of consecutive instances in a new random 
+    // order, each block in order: reads are sequential within a block
+    BlockShuffle
+};
+
+/* Sampler
+ *
+ * The order in which the training visits the instances of a dataset. The 
+ * sequence is determined by the seed, and an epoch spans size() draws, the
+ * epochs following each other across mini-batches. By default, each epoch 
+ * is a new permutation; Uniform gives the draws with replacement that the
+ * training used before.
+ */
+class Sampler {
+    public:
+        using Seed = std::default_random_engine::result_type;
+
+        /* Samples the indices [0, size). `block_size` is the number of 
+         * instances in a block, for BlockShuffle. */
+        explicit Sampler(std::size_t size, 
+                Sampling sampling = Sampling::Permutation,
+                Seed seed = std::default_random_engine::default_seed,
+                std::size_t block_size = 256);
+
+        std::size_t size() const { return size_p; }
+        Sampling sampling() const { return sampling_p; }
+        /* The index of the next instance. */
+        std::size_t next();
+        /* Restarts the sequence from the seed. */
+        void reset();
+
+    private:
+        std::size_t size_p;
+        Sampling sampling_p;
+        Seed seed;
+        std::size_t block_size;
+        std::default_random_engine generator;
+        std::uniform_int_distribution<std::size_t> distribution;
+        // the first instance of each block, shuffled at each epoch; a
+        // permutation has blocks of one instance
+        std::vector<std::size_t> blocks;
+        std::size_t block;
+        // the next instance and the end of the current block
+        std::size_t position;
+        std::size_t end;
+};
+
+} // namespace my_nn
+
+#endif // SAMPLER_H
@@ -0,0 +1,134 @@
+/*      server.cpp
+ *
+ *      implementation file for the InferenceServer class
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "inference.h"
+#include "model.h"
+#include "queue.h"
+#include "server.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+BasicInferenceServer<Scalar>::BasicInferenceServer(
+        const BasicModel<Scalar> &model, std::size_t max_batch,
+        std::chrono::microseconds max_wait, std::size_t queue_capacity)
+    : model{model}, max_batch_p{max_batch}, max_wait{max_wait}, 
+    queue(queue_capacity), context(model, max_batch),
+    inputs(model.input(), max_batch), batch{new Request[max_batch]}, 
+    requests_p{0}, batches_p{0}, sleeping{false}, stopping{false}
+{
+    worker = std::thread(&BasicInferenceServer::work, this);
+}
+
+template <typename Scalar>
+BasicInferenceServer<Scalar>::~BasicInferenceServer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+template <typename Scalar>
+auto BasicInferenceServer<Scalar>::submit(Vector input) -> std::future<Vector>
+{
+    if (static_cast<std::size_t>(input.size()) != model.input()) {
+        throw std::invalid_argument("Input does not fit the model");
+    }
+    Request request{std::move(input), std::promise<Vector>()};
+    auto output = request.output.get_future();
+    while (!queue.push(std::move(request))) {
+        // the queue is full: wait for the batching thread to take some
+        std::this_thread::yield();
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load()) {
+        // the batching thread holds the lock until it waits, so the
+        // notification cannot come before
+        std::lock_guard<std::mutex> lock(mutex);
+        wake.notify_one();
+    }
+    return output;
+}
+
+template <typename Scalar>
+void BasicInferenceServer<Scalar>::work() {
+    while (true) {
+        if (!queue.pop(batch[0])) {
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping = true;
+            // pairs with the fence in submit(): either the request is seen
+            // here, or the submitting thread sees `sleeping`
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool found;
+            while (!(found = queue.pop(batch[0])) && !stopping) {
+                wake.wait(lock);
+            }
+            sleeping = false;
+            if (!found) {
+                // stopping, and the requests submitted before are served
+                return;
+            }
+        }
+        std::size_t count = 1;
+        // gather more requests until the batch is full or the first one has
+        // waited long enough
+        const auto deadline = std::chrono::steady_clock::now() + max_wait;
+        while (count < max_batch_p) {
+            if (queue.pop(batch[count])) {
+                count++;
+            } else if (std::chrono::steady_clock::now() >= deadline) {
+                break;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        serve(batch.get(), count);
+    }
+}
+
+template <typename Scalar>
+void BasicInferenceServer<Scalar>::serve(Request *requests, std::size_t count) {
+    // counted first, so that a client with its output sees them up to date
+    requests_p += count;
+    batches_p++;
+    try {
+        for (std::size_t j = 0; j < count; j++) {
+            inputs.col(j) = requests[j].input;
+        }
+        auto outputs = model.forward(inputs.leftCols(count), context);
+        for (std::size_t j = 0; j < count; j++) {
+            requests[j].output.set_value(outputs.col(j));
+        }
+    } catch (...) {
+        for (std::size_t j = 0; j < count; j++) {
+            try {
+                requests[j].output.set_exception(std::current_exception());
+            } catch (const std::future_error &) {
+                // this one already had its output
+            }
+        }
+    }
+    for (std::size_t j = 0; j < count; j++) {
+        requests[j] = Request();
+    }
+}
+
+template class BasicInferenceServer<float>;
+template class BasicInferenceServer<double>;
+
+} // namespace my_nn
@@ -0,0 +1,98 @@
+/*      server.h
+ *
+ *      header file for the InferenceServer class
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "inference.h"
+#include "layer.h"
+#include "model.h"
+#include "queue.h"
+
+namespace my_nn {
+
+/* BasicInferenceServer
+ *
+ * Serves a model to many threads, each submitting one input at a time. The
+ * requests go through a lock-free queue to a batching thread, which gathers 
+ * them into a mini-batch until it has `max_batch` of them or the first one
+ * has waited `max_wait`, applies the model to the whole batch in one product
+ * per layer, and fulfills the futures of the requests. A request thus waits
+ * at most max_wait plus one batch, in exchange for the throughput of the
+ * batched products.
+ *
+ * While a batch is being gathered, the batching thread polls the queue; it 
+ * sleeps when there is no request at all.
+ */
+template <typename Scalar>
+class BasicInferenceServer {
+    public:
+        using Matrix = MatrixT<Scalar>;
+        using Vector = VectorT<Scalar>;
+
+        /* Serves `model`, which must outlive the server and not change while
+         * it runs. At most `queue_capacity` requests wait in the queue; 
+         * submit() waits for room beyond that. */
+        BasicInferenceServer(const BasicModel<Scalar> &model, 
+                std::size_t max_batch, std::chrono::microseconds max_wait,
+                std::size_t queue_capacity = 1024);
+        /* Serves the pending requests, then stops. */
+        ~BasicInferenceServer();
+        BasicInferenceServer(const BasicInferenceServer &other) = delete;
+        BasicInferenceServer &operator=(const BasicInferenceServer &other) 
+            = delete;
+
+        /* Queues `input`; the future gets the output of the model. Safe to
+         * call from any number of threads. */
+        std::future<Vector> submit(Vector input);
+
+        std::size_t max_batch() const { return max_batch_p; }
+        /* The number of requests served, and of batches that served them. */
+        std::size_t requests() const { return requests_p.load(); }
+        std::size_t batches() const { return batches_p.load(); }
+
+    private:
+        struct Request {
+            Vector input;
+            std::promise<Vector> output;
+        };
+
+        void work();
+        /* Applies the model to the `count` first requests of `batch`. */
+        void serve(Request *batch, std::size_t count);
+
+        const BasicModel<Scalar> &model;
+        const std::size_t max_batch_p;
+        const std::chrono::microseconds max_wait;
+        BoundedQueue<Request> queue;
+        BasicInferenceContext<Scalar> context;
+        Matrix inputs;
+        std::unique_ptr<Request[]> batch;
+        std::atomic<std::size_t> requests_p;
+        std::atomic<std::size_t> batches_p;
+        // to wake the batching thread up when it sleeps
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::atomic<bool> sleeping;
+        std::atomic<bool> stopping;
+        std::thread worker;
+};
+
+using InferenceServer = BasicInferenceServer<elem_type>;
+
+extern template class BasicInferenceServer<float>;
+extern template class BasicInferenceServer<double>;
+
+} // namespace my_nn
+
+#endif // SERVER_H
@@ -0,0 +1,150 @@
+/*      static_model.h
+ *
+ *      header file for the StaticModel class
+ */
+
+#ifndef STATIC_MODEL_H
+#define STATIC_MODEL_H
+
+#include <cstdlib>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "Eigen/Dense"
+
+#include "activation.h"
+#include "layer.h"
+#include "model.h"
+
+namespace my_nn {
+
+/* BasicStaticModel
+ *
+ * An inference-only copy of a tiny model whose sizes are known at compile
+ * time: `Input` inputs, then one layer per value of `Nodes`. The parameters
+ * are fixed-size Eigen matrices held in the object, so applying it does not
+ * allocate and Eigen unrolls the products. Meant for models of a few dozen
+ * nodes per layer; Eigen refuses fixed-size matrices beyond its stack
+ * allocation limit.
+ */
+template <typename Scalar, int Input, int... Nodes>
+class BasicStaticModel {
+    static_assert(sizeof...(Nodes) > 0, "A model needs at least one layer");
+
+    static constexpr int sizes[] = {Input, Nodes...};
+    static constexpr std::size_t depth = sizeof...(Nodes);
+
+    template <int Fanin, int Size>
+    struct Layer {
+        Eigen::Matrix<Scalar, Size, Fanin> weights;
+        Eigen::Matrix<Scalar, Size, 1> bias;
+        Activation activation;
+    };
+    template <std::size_t... I>
+    static auto layer_types(std::index_sequence<I...>)
+        -> std::tuple<Layer<sizes[I], sizes[I + 1]>...>;
+    using Layers = decltype(layer_types(std::make_index_sequence<depth>()));
+
+    public:
+        using InputVector = Eigen::Matrix<Scalar, Input, 1>;
+        using OutputVector = Eigen::Matrix<Scalar, sizes[depth], 1>;
+
+        /* Copies the parameters of `model`, which must have the same
+         * sizes. */
+        explicit BasicStaticModel(const BasicModel<Scalar> &model);
+
+        /* Apply the model to some input */
+        OutputVector operator()(const InputVector &input) const {
+            return apply<0>(input);
+        }
+
+        static constexpr int input() { return Input; }
+        static constexpr int output() { return sizes[depth]; }
+        static constexpr std::size_t layer_number() { return depth; }
+
+    private:
+        template <std::size_t I, typename Vector>
+        auto apply(const Vector &x) const {
+            auto &layer = std::get<I>(layers);
+            Eigen::Matrix<Scalar, sizes[I + 1], 1> y = layer.bias;
+            y.noalias() += layer.weights * x;
+            activate(y, layer.activation);
+            if constexpr (I + 1 < depth) {
+                return apply<I + 1>(y);
+            } else {
+                return y;
+            }
+        }
+
+        template <std::size_t I>
+        void load(const BasicModel<Scalar> &model) {
+            auto &layer = std::get<I>(layers);
+            layer.weights = model.get_layer(I).weights();
+            layer.bias = model.get_layer(I).bias();
+            layer.activation = model.get_layer(I).activation();
+        }
+
+        template <std::size_t... I>
+        void load(const BasicModel<Scalar> &model, std::index_sequence<I...>) {
+            (load<I>(model), ...);
+        }
+
+        /* The activations are only known at run time, but there is a
+         * single well-predicted branch per layer. */
+        template <int Size>
+        static void activate(Eigen::Matrix<Scalar, Size, 1> &y,
+                Activation activation) {
+            switch (activation) {
+                case Activation::None:
+                    break;
+                case Activation::ReLU:
+                    y = y.unaryExpr(relu_op<Scalar>());
+                    break;
+                case Activation::Sigmoid:
+                    y = y.unaryExpr(sigmoid_op<Scalar>());
+                    break;
+                case Activation::Softmax:
+                    y.array() = (y.array() - y.maxCoeff()).exp();
+                    y *= Scalar(1) / y.sum();
+                    break;
+                case Activation::Tanh:
+                    y = y.unaryExpr(tanh_op<Scalar>());
+                    break;
+                case Activation::LeakyReLU:
+                    y = y.unaryExpr(leaky_relu_op<Scalar>());
+                    break;
+                case Activation::SiLU:
+                    y = y.unaryExpr(silu_op<Scalar>());
+                    break;
+                case Activation::GELU:
+                    y = y.unaryExpr(gelu_op<Scalar>());
+                    break;
+            }
+        }
+
+        Layers layers;
+};
+
+template <typename Scalar, int Input, int... Nodes>
+BasicStaticModel<Scalar, Input, Nodes...>::BasicStaticModel(
+        const BasicModel<Scalar> &model)
+{
+    bool fits = model.input() == static_cast<std::size_t>(Input) &&
+        model.layer_number() == depth;
+    for (std::size_t i = 0; fits && i < depth; i++) {
+        fits = model.get_layer(i).nodes() ==
+            static_cast<std::size_t>(sizes[i + 1]);
+    }
+    if (!fits) {
+        throw std::invalid_argument("Model does not have the static sizes");
+    }
+    load(model, std::make_index_sequence<depth>());
+}
+
+template <int Input, int... Nodes>
+using StaticModel = BasicStaticModel<elem_type, Input, Nodes...>;
+
+} // namespace my_nn
+
+#endif // STATIC_MODEL_H
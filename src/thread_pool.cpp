@@ -0,0 +1,89 @@
+/*      thread_pool.cpp
+ *
+ *      implementation file for the ThreadPool class
+ */
+
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "thread_pool.h"
+
+namespace my_nn {
+
+ThreadPool::ThreadPool(std::size_t threads)
+    : workers{}, task_p{nullptr}, generation{0}, pending{0}, stopping{false},
+    error{}
+{
+    if (threads == 0) {
+        throw std::invalid_argument("A thread pool needs at least one thread");
+    }
+    for (std::size_t i = 1; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::call(std::size_t index) {
+    try {
+        (*task_p)(index);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+}
+
+void ThreadPool::run(const std::function<void(std::size_t)> &task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task_p = &task;
+        pending = workers.size();
+        error = nullptr;
+        generation++;
+    }
+    start.notify_all();
+    call(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+    task_p = nullptr;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::work(std::size_t index) {
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+        call(index);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending--;
+        }
+        done.notify_one();
+    }
+}
+
+} // namespace my_nn
@@ -0,0 +1,57 @@
+/*      thread_pool.h
+ *
+ *      header file for the ThreadPool class
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace my_nn {
+
+/* ThreadPool
+ *
+ * A fixed set of threads running the same task in fork-join fashion: `run`
+ * calls the task once per thread, with the index of the thread, and returns
+ * when all the calls are done. The calling thread takes index 0, so a pool 
+ * of size 1 starts no thread at all.
+ */
+class ThreadPool {
+    public:
+        explicit ThreadPool(std::size_t threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &other) = delete;
+        ThreadPool &operator=(const ThreadPool &other) = delete;
+
+        std::size_t size() const { return workers.size() + 1; }
+        /* Runs `task(i)` for each i in [0, size()), and waits for all of 
+         * them. If some of the calls throw, one of the exceptions is 
+         * rethrown here. */
+        void run(const std::function<void(std::size_t)> &task);
+
+    private:
+        void work(std::size_t index);
+        void call(std::size_t index);
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable start;
+        std::condition_variable done;
+        const std::function<void(std::size_t)> *task_p;
+        // incremented on each run, so that the workers know there is a task
+        std::size_t generation;
+        std::size_t pending;
+        bool stopping;
+        std::exception_ptr error;
+};
+
+} // namespace my_nn
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,167 @@
+/*      trainer.cpp
+ *
+ *      implementation file for the ParallelTrainer class
+ */
+
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+#include "optimizer.h"
+#include "sampler.h"
+#include "thread_pool.h"
+#include "trainer.h"
+#include "workspace.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+BasicParallelTrainer<Scalar>::BasicParallelTrainer(Model &model, 
+        std::size_t batch_size, std::size_t threads)
+    : model{model}, batch_size_p{batch_size}, pool(threads), slots{},
+    indices(batch_size)
+{
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+    // each thread gets at most this many instances of a batch
+    const std::size_t share = (batch_size + threads - 1) / threads;
+    slots.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+        slots.emplace_back(model, share);
+    }
+}
+
+template <typename Scalar>
+void BasicParallelTrainer<Scalar>::check(const DatasetView &data) const {
+    const std::size_t layers = model.layer_number();
+    if (data.feature_size() != model.input() || layers == 0 ||
+            data.label_size() != model.get_layer(layers - 1).nodes()) {
+        throw std::invalid_argument("Dataset does not fit the model");
+    }
+}
+
+template <typename Scalar>
+void BasicParallelTrainer<Scalar>::compute(const DatasetView &data, 
+        std::size_t index) {
+    const std::size_t begin = batch_size_p * index / slots.size();
+    const std::size_t end = batch_size_p * (index + 1) / slots.size();
+    const std::size_t count = end - begin;
+    auto &workspace = slots[index].workspace;
+    if (count == 0) {  // more threads than instances in the batch
+        workspace.flat_gradients().setZero();
+        return;
+    }
+    auto &inputs = workspace.inputs();
+    auto &labels = workspace.targets();
+    for (std::size_t b = 0; b < count; b++) {
+        inputs.col(b) = data.features().col(indices[begin + b]);
+        labels.col(b) = data.labels().col(indices[begin + b]);
+    }
+    model.gradient(inputs.leftCols(count), labels.leftCols(count), workspace);
+    // the gradient is averaged over the share, so weighting it by the share
+    // makes the sum the average over the whole batch.
+    workspace.flat_gradients() *= 
+        static_cast<Scalar>(count) / static_cast<Scalar>(batch_size_p);
+}
+
+template <typename Scalar>
+void BasicParallelTrainer<Scalar>::reduce() {
+    const std::size_t threads = slots.size();
+    for (std::size_t stride = 1; stride < threads; stride *= 2) {
+        pool.run([&](std::size_t index) {
+            if (index % (2 * stride) == 0 && index + stride < threads) {
+                slots[index].workspace.flat_gradients() += 
+                    slots[index + stride].workspace.flat_gradients();
+            }
+        });
+    }
+}
+
+template <typename Scalar>
+void BasicParallelTrainer<Scalar>::train(const DatasetView &data, 
+        std::size_t epochs, Optimizer &optimizer) {
+    check(data);
+    // same sampling as Model::train
+    Sampler sampler(data.size());
+    train(data, epochs, optimizer, sampler);
+}
+
+template <typename Scalar>
+void BasicParallelTrainer<Scalar>::train(const DatasetView &data, 
+        std::size_t epochs, Optimizer &optimizer, Sampler &sampler) {
+    check(data);
+    auto inst_number = data.size();
+    if (sampler.size() != inst_number) {
+        throw std::invalid_argument("Sampler of another dataset");
+    }
+    auto steps = (inst_number + batch_size_p - 1) / batch_size_p;
+    for (std::size_t i = 0; i < epochs; i++) {
+        for (std::size_t j = 0; j < steps; j++) {
+            for (auto &index : indices) {
+                index = sampler.next();
+            }
+            pool.run([&](std::size_t index) { compute(data, index); });
+            reduce();
+            optimizer.step(model, slots[0].workspace);
+        }
+    }
+}
+
+template <typename Scalar>
+void BasicParallelTrainer<Scalar>::hogwild(const DatasetView &data, 
+        std::size_t index, std::size_t steps, Scalar learning_rate,
+        Sampling sampling) {
+    // each thread has its own sequence of instances; the first one has the
+    // same as Model::train
+    Sampler sampler(data.size(), sampling, 
+            std::default_random_engine::default_seed + index);
+    auto &workspace = slots[index].workspace;
+    auto &inputs = workspace.inputs();
+    auto &labels = workspace.targets();
+    Scalar *parameters = model.parameters().data();
+    const Scalar *gradients = workspace.flat_gradients().data();
+    const std::size_t size = model.parameters().size();
+    for (std::size_t j = 0; j < steps; j++) {
+        for (std::size_t b = 0; b < workspace.batch_size(); b++) {
+            auto instance = sampler.next();
+            inputs.col(b) = data.features().col(instance);
+            labels.col(b) = data.labels().col(instance);
+        }
+        model.gradient(inputs, labels, workspace);
+        // the gradients of dead ReLU units are exactly zero; skipping them
+        // avoids writing to cache lines the other threads are using.
+        for (std::size_t k = 0; k < size; k++) {
+            if (gradients[k] != Scalar(0)) {
+                parameters[k] -= learning_rate * gradients[k];
+            }
+        }
+    }
+}
+
+template <typename Scalar>
+void BasicParallelTrainer<Scalar>::train_hogwild(const DatasetView &data, 
+        std::size_t epochs, Scalar learning_rate, Sampling sampling) {
+    // checked once here, before any thread writes to the parameters
+    check(data);
+    auto inst_number = data.size();
+    if (inst_number == 0) {
+        throw std::invalid_argument("No instances");
+    }
+    const std::size_t share = slots[0].workspace.batch_size();
+    const std::size_t steps = epochs * ((inst_number + share - 1) / share);
+    const std::size_t threads = slots.size();
+    pool.run([&](std::size_t index) {
+        hogwild(data, index, 
+                steps * (index + 1) / threads - steps * index / threads,
+                learning_rate, sampling);
+    });
+}
+
+template class BasicParallelTrainer<float>;
+template class BasicParallelTrainer<double>;
+
+} // namespace my_nn
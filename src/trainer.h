@@ -0,0 +1,104 @@
+/*      trainer.h
+ *
+ *      header file for the ParallelTrainer class
+ */
+
+#ifndef TRAINER_H
+#define TRAINER_H
+
+#include <cstdlib>
+#include <vector>
+
+#include "dataset.h"
+#include "model.h"
+#include "optimizer.h"
+#include "sampler.h"
+#include "thread_pool.h"
+#include "workspace.h"
+
+namespace my_nn {
+
+/* BasicParallelTrainer
+ *
+ * Data-parallel training of a model: each mini-batch is split between the 
+ * threads of a pool, each thread computes the gradient of its share into its
+ * own workspace, then the gradients are summed pairwise, as a tree, before
+ * the optimizer step. The result is the same as Model::train with the same 
+ * batch size, up to the rounding of the sums.
+ *
+ * It can also train Hogwild-style: the threads then run independently, each
+ * on its own mini-batches, and apply their updates to the parameters of the
+ * model as soon as they have them, without any lock or reduction.
+ */
+template <typename Scalar>
+class BasicParallelTrainer {
+    public:
+        using Model = BasicModel<Scalar>;
+        using DatasetView = BasicDatasetView<Scalar>;
+        using Optimizer = BasicOptimizer<Scalar>;
+        using Workspace = BasicWorkspace<Scalar>;
+
+        /* Trains `model`, which must outlive the trainer, with mini-batches
+         * of `batch_size` instances split between `threads` threads. */
+        BasicParallelTrainer(Model &model, std::size_t batch_size, 
+                std::size_t threads);
+
+        std::size_t batch_size() const { return batch_size_p; }
+        std::size_t threads() const { return pool.size(); }
+        /* Same schedule as Model::train: each epoch draws as many instances
+         * as there are in `data`. */
+        void train(const DatasetView &data, std::size_t epochs, 
+                Optimizer &optimizer);
+        /* Same, visiting the instances in the order of `sampler`. */
+        void train(const DatasetView &data, std::size_t epochs, 
+                Optimizer &optimizer, Sampler &sampler);
+        /* Hogwild training with plain gradient descent. Each thread draws 
+         * mini-batches of batch_size() / threads() instances (rounded up) 
+         * and descends along their gradient in the shared parameters; the 
+         * threads together draw as many instances per epoch as there are in
+         * `data`. The updates of the threads race with each other on 
+         * purpose: only the non-zero entries of a gradient are written, and
+         * with sparse gradients the threads seldom touch the same parameters.
+         * With a single thread, this is Model::train with SGD. Each thread
+         * has its own Sampler with the given `sampling`, seeded by its index.
+         */
+        void train_hogwild(const DatasetView &data, std::size_t epochs, 
+                Scalar learning_rate, 
+                Sampling sampling = Sampling::Permutation);
+
+    private:
+        /* The workspace of each thread, on its own cache lines so that the
+         * threads do not write next to each other. */
+        struct alignas(64) Slot {
+            Slot(const Model &model, std::size_t batch_size)
+                : workspace(model, batch_size) {}
+            Workspace workspace;
+        };
+
+        /* Throws if the instances of `data` do not fit the model. */
+        void check(const DatasetView &data) const;
+        /* Gradient of the share of thread `index` of the current batch, 
+         * weighted by the size of its share. */
+        void compute(const DatasetView &data, std::size_t index);
+        /* Sums the gradients of all the threads in the first workspace. */
+        void reduce();
+        /* The loop of thread `index` in Hogwild training */
+        void hogwild(const DatasetView &data, std::size_t index, 
+                std::size_t steps, Scalar learning_rate, Sampling sampling);
+
+        Model &model;
+        const std::size_t batch_size_p;
+        ThreadPool pool;
+        std::vector<Slot> slots;
+        // the instances of the current batch
+        std::vector<std::size_t> indices;
+};
+
+using ParallelTrainer = BasicParallelTrainer<elem_type>;
+
+extern template class BasicParallelTrainer<float>;
+extern template class BasicParallelTrainer<double>;
+
+} // namespace my_nn
+
+#endif // TRAINER_H
@@ -0,0 +1,52 @@
+/*      workspace.cpp
+ *
+ *      implementation file for the Workspace class
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#include "layer.h"
+#include "model.h"
+#include "workspace.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+BasicWorkspace<Scalar>::BasicWorkspace(const BasicModel<Scalar> &model, 
+        std::size_t batch_size)
+    : batch_size_p{batch_size}, outputs(model.layer_number()), 
+    deltas(model.layer_number()), flat_gradients_p(model.parameters().size()),
+    loss_p{0}, gradients_p{}
+{
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+    if (model.layer_number() == 0) {
+        throw std::invalid_argument("The model has no layer");
+    }
+    std::size_t widest = 0;
+    std::size_t offset = 0;
+    Scalar *data = flat_gradients_p.data();
+    for (std::size_t i = 0; i < model.layer_number(); i++) {
+        auto &layer = model.get_layer(i);
+        outputs[i] = Matrix(layer.nodes(), batch_size);
+        deltas[i] = Matrix(layer.nodes(), batch_size);
+        gradients_p.emplace_back(
+                MatrixMap(data + offset, layer.nodes(), layer.input()),
+                VectorMap(data + offset + layer.weights().size(), layer.nodes()));
+        offset += layer.parameter_number();
+        widest = std::max(widest, layer.nodes());
+    }
+    scratch = Matrix(widest, batch_size);
+    inputs_p = Matrix(model.input(), batch_size);
+    targets_p = Matrix(model.get_layer(model.layer_number() - 1).nodes(), 
+            batch_size);
+}
+
+template class BasicWorkspace<float>;
+template class BasicWorkspace<double>;
+
+} // namespace my_nn
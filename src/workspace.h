@@ -0,0 +1,90 @@
+/*      workspace.h
+ *
+ *      header file for the Workspace class
+ */
+
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <cstdlib>
+#include <vector>
+
+#include "layer.h"
+
+namespace my_nn {
+
+template <typename Scalar>
+class BasicModel;
+
+/* BasicWorkspace
+ *
+ * Holds every buffer needed by the training of a Model: the staging buffers
+ * for a mini-batch, the outputs and errors of each layer, and the gradients.
+ * It is sized once from the layers of the model, for mini-batches of up to
+ * `batch_size` samples, and then reused so that the training steps do not
+ * allocate.
+ */
+template <typename Scalar>
+class BasicWorkspace {
+    public:
+        using Matrix = MatrixT<Scalar>;
+        using Vector = VectorT<Scalar>;
+        using MatrixMap = Eigen::Map<Matrix>;
+        using VectorMap = Eigen::Map<Vector>;
+
+        BasicWorkspace(const BasicModel<Scalar> &model, std::size_t batch_size);
+        /* The gradients are views into the workspace's own buffer, so it 
+         * can be moved but not copied. */
+        BasicWorkspace(const BasicWorkspace &other) = delete;
+        BasicWorkspace(BasicWorkspace &&other) = default;
+
+        std::size_t batch_size() const { return batch_size_p; }
+        /* Staging buffers where the training gathers a mini-batch, one 
+         * sample per column. */
+        Matrix &inputs() { return inputs_p; }
+        Matrix &targets() { return targets_p; }
+        /* The gradients computed by the last call to Model::gradient, 
+         * one pair of weights and bias per layer. */
+        const std::vector<std::pair<MatrixMap, VectorMap>> &gradients() const {
+            return gradients_p;
+        }
+        /* The loss summed over the mini-batch by the last call to 
+         * Model::gradient. */
+        Scalar loss() const { return loss_p; }
+        /* The same gradients in one buffer, laid out like 
+         * Model::parameters(). Writable, for the reductions of the parallel
+         * training. */
+        Eigen::Map<const Vector> flat_gradients() const { 
+            return Eigen::Map<const Vector>(flat_gradients_p.data(), 
+                    flat_gradients_p.size());
+        }
+        VectorMap flat_gradients() { 
+            return VectorMap(flat_gradients_p.data(), flat_gradients_p.size());
+        }
+
+    private:
+        friend class BasicModel<Scalar>;
+
+        std::size_t batch_size_p;
+        Matrix inputs_p;
+        Matrix targets_p;
+        // the output of each layer, one column per sample
+        std::vector<Matrix> outputs;
+        // the derivative of the activation function, then the errors
+        std::vector<Matrix> deltas;
+        // temporary for the backpropagation, as tall as the widest layer
+        Matrix scratch;
+        Vector flat_gradients_p;
+        Scalar loss_p;
+        // views into flat_gradients_p
+        std::vector<std::pair<MatrixMap, VectorMap>> gradients_p;
+};
+
+using Workspace = BasicWorkspace<elem_type>;
+
+extern template class BasicWorkspace<float>;
+extern template class BasicWorkspace<double>;
+
+} // namespace my_nn
+
+#endif // WORKSPACE_H
@@ -0,0 +1,155 @@
+/*      test_activation.cpp
+ *
+ *      Tests for the activation functions and their kernels.
+ */
+
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "activation.h"
+#include "layer.h"
+using namespace my_nn;
+
+/* The activation functors must be vectorized by Eigen */
+static_assert(Eigen::internal::functor_traits<relu_op<double>>::PacketAccess);
+static_assert(Eigen::internal::functor_traits<relu_op<float>>::PacketAccess);
+static_assert(
+        Eigen::internal::functor_traits<relu_derivative_op<double>>::PacketAccess);
+static_assert(Eigen::internal::functor_traits<sigmoid_op<double>>::PacketAccess);
+static_assert(Eigen::internal::functor_traits<sigmoid_op<float>>::PacketAccess);
+static_assert(Eigen::internal::functor_traits<tanh_op<double>>::PacketAccess);
+static_assert(Eigen::internal::functor_traits<tanh_op<float>>::PacketAccess);
+static_assert(
+        Eigen::internal::functor_traits<leaky_relu_op<double>>::PacketAccess);
+static_assert(Eigen::internal::functor_traits<silu_op<double>>::PacketAccess);
+static_assert(Eigen::internal::functor_traits<gelu_op<float>>::PacketAccess);
+
+/* Check that the ReLU kernels add the bias, then clamp the negative values,
+ * on sizes which do not fill whole packets.
+ */
+TEST(Activation, ReLUKernels) {
+    auto &kernels = activation_kernels<double>(Activation::ReLU);
+    Matrix act = Matrix::Random(7, 3);
+    Vector bias = Vector::Random(7);
+    Matrix expected = act;
+    Matrix der(7, 3);
+    kernels.forward_derivative(act, bias, der);
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 7; i++) {
+            auto x = expected(i, j) + bias(i);
+            ASSERT_DOUBLE_EQ(act(i, j), x > 0.0 ? x : 0.0);
+            ASSERT_EQ(der(i, j), x > 0.0 ? 1.0 : 0.0);
+        }
+    }
+}
+
+/* Check that the kernels without activation only add the bias */
+TEST(Activation, NoneKernels) {
+    auto &kernels = activation_kernels<float>(Activation::None);
+    MatrixT<float> act = MatrixT<float>::Random(5, 2);
+    VectorT<float> bias = VectorT<float>::Random(5);
+    MatrixT<float> expected = act.colwise() + bias;
+    MatrixT<float> der(5, 2);
+    kernels.forward_derivative(act, bias, der);
+    ASSERT_EQ(act, expected);
+    ASSERT_EQ(der, MatrixT<float>::Ones(5, 2));
+}
+
+/* Check the sigmoid kernels against the formula, including pre-activations
+ * large enough to overflow exp(-x) in float. */
+TEST(Activation, SigmoidKernels) {
+    auto &kernels = activation_kernels<float>(Activation::Sigmoid);
+    MatrixT<float> act = MatrixT<float>::Random(9, 3) * 8.0f;
+    act(0, 0) = -200.0f;
+    act(1, 0) = 200.0f;
+    VectorT<float> bias = VectorT<float>::Random(9);
+    MatrixT<float> expected = act;
+    MatrixT<float> der(9, 3);
+    kernels.forward_derivative(act, bias, der);
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < 9; i++) {
+            double x = double(expected(i, j)) + bias(i);
+            double y = 1.0 / (1.0 + std::exp(-x));
+            ASSERT_NEAR(act(i, j), y, 1e-6);
+            ASSERT_NEAR(der(i, j), y * (1.0 - y), 1e-6);
+        }
+    }
+    ASSERT_NEAR(act(0, 0), 0.0f, 1e-30f);
+    ASSERT_EQ(act(1, 0), 1.0f);
+}
+
+/* Check that softmax turns each column into a probability distribution, 
+ * without overflowing on large pre-activations. */
+TEST(Activation, SoftmaxKernel) {
+    auto &kernels = activation_kernels<double>(Activation::Softmax);
+    Matrix act = Matrix::Random(6, 4);
+    act(2, 1) = 1000.0;
+    Vector bias = Vector::Random(6);
+    Matrix expected = act;
+    kernels.forward(act, bias);
+    for (int j = 0; j < 4; j++) {
+        ASSERT_NEAR(act.col(j).sum(), 1.0, 1e-12);
+        if (j != 1) {
+            Vector e = (expected.col(j) + bias).array().exp();
+            for (int i = 0; i < 6; i++) {
+                ASSERT_NEAR(act(i, j), e(i) / e.sum(), 1e-12);
+            }
+        }
+    }
+    ASSERT_DOUBLE_EQ(act(2, 1), 1.0);
+}
+
+namespace {
+
+/* The activations applied coefficient-wise, with their definitions. */
+const std::vector<std::pair<Activation, std::function<double(double)>>> 
+    coefficient_wise = {
+    {Activation::ReLU, [](double x) { return x > 0.0 ? x : 0.0; }},
+    {Activation::Sigmoid, [](double x) { return 1.0 / (1.0 + std::exp(-x)); }},
+    {Activation::Tanh, [](double x) { return std::tanh(x); }},
+    {Activation::LeakyReLU, [](double x) { return x > 0.0 ? x : 0.01 * x; }},
+    {Activation::SiLU, [](double x) { return x / (1.0 + std::exp(-x)); }},
+    {Activation::GELU, [](double x) { 
+        return 0.5 * x * (1.0 + std::tanh(0.7978845608028654 * 
+                    (x + 0.044715 * x * x * x))); 
+    }}
+};
+
+/* Checks the kernels of the activations against their definitions, and 
+ * the derivatives against central differences, on sizes which do not fill
+ * whole packets. */
+template <typename Scalar>
+void check_kernels(double tolerance) {
+    MatrixT<Scalar> pre = MatrixT<Scalar>::Random(11, 3) * Scalar(4);
+    VectorT<Scalar> bias = VectorT<Scalar>::Random(11);
+    for (auto &[activation, f] : coefficient_wise) {
+        auto &kernels = activation_kernels<Scalar>(activation);
+        MatrixT<Scalar> act = pre;
+        kernels.forward(act, bias);
+        MatrixT<Scalar> fused = pre;
+        MatrixT<Scalar> der(11, 3);
+        kernels.forward_derivative(fused, bias, der);
+        for (int j = 0; j < 3; j++) {
+            for (int i = 0; i < 11; i++) {
+                const double x = double(pre(i, j)) + double(bias(i));
+                const double h = 1e-5;
+                ASSERT_NEAR(act(i, j), f(x), tolerance);
+                ASSERT_NEAR(fused(i, j), act(i, j), tolerance);
+                ASSERT_NEAR(der(i, j), (f(x + h) - f(x - h)) / (2 * h), 
+                        tolerance + 1e-6);
+            }
+        }
+    }
+}
+
+} // namespace
+
+/* Check all the coefficient-wise activations, in double and float. */
+TEST(Activation, CoefficientWiseKernels) {
+    check_kernels<double>(1e-12);
+    check_kernels<float>(1e-5);
+}
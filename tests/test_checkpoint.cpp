@@ -0,0 +1,128 @@
+/*      test_checkpoint.cpp
+ *
+ *      Tests for saving and loading model checkpoints.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "checkpoint.h"
+#include "model.h"
+using namespace my_nn;
+
+namespace {
+
+Model make_model() {
+    Model m(5);
+    m.add_layer(4, Activation::ReLU);
+    m.add_layer(3, Activation::ReLU);
+    m.add_layer(2);
+    m.set_loss(LossFunction::LstSq);
+    return m;
+}
+
+std::string checkpoint_path(const std::string &name) {
+    return ::testing::TempDir() + name;
+}
+
+/* Overwrites the bytes of `value` at `offset` in the file at `path` */
+template <typename T>
+void overwrite(const std::string &path, std::size_t offset, T value) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+}
+
+/* Check that a saved model loads back with the same layers and parameters */
+TEST(Checkpoint, CheckpointLoad) {
+    Model m = make_model();
+    auto path = checkpoint_path("load.ckpt");
+    save_model(m, path);
+    Model loaded = load_model<double>(path);
+    ASSERT_EQ(loaded.input(), 5);
+    ASSERT_EQ(loaded.layer_number(), 3);
+    ASSERT_EQ(loaded.loss(), LossFunction::LstSq);
+    ASSERT_EQ(loaded.get_layer(1).activation(), Activation::ReLU);
+    ASSERT_EQ(loaded.get_layer(2).activation(), Activation::None);
+    ASSERT_EQ(loaded.parameters(), m.parameters());
+    std::remove(path.c_str());
+}
+
+/* Check that a mapped model uses the parameters in place and computes the same
+ * outputs, and that changing it leaves the file unchanged.
+ */
+TEST(Checkpoint, CheckpointMap) {
+    Model m = make_model();
+    auto path = checkpoint_path("map.ckpt");
+    save_model(m, path);
+    Model mapped = map_model<double>(path);
+    ASSERT_EQ(mapped.parameters(), m.parameters());
+    ASSERT_EQ(mapped.get_layer(0).weights().data(), mapped.parameters().data());
+    ASSERT_EQ(reinterpret_cast<std::uintptr_t>(mapped.parameters().data()) % 64, 0);
+    Matrix x = Matrix::Random(5, 10);
+    ASSERT_EQ(mapped.forward(x), m.forward(x));
+
+    Model copy(mapped);
+    ASSERT_NE(copy.parameters().data(), mapped.parameters().data());
+    ASSERT_EQ(copy.parameters(), m.parameters());
+
+    mapped.parameters().setZero();
+    ASSERT_EQ(load_model<double>(path).parameters(), m.parameters());
+    std::remove(path.c_str());
+}
+
+/* Check that a mapped model can be trained, and outlives the other models */
+TEST(Checkpoint, CheckpointMapTrain) {
+    Model m = make_model();
+    auto path = checkpoint_path("train.ckpt");
+    save_model(m, path);
+    Model mapped = map_model<double>(path);
+    std::remove(path.c_str());
+    Dataset data(Matrix::Random(5, 20), Matrix::Random(2, 20));
+    ASSERT_NO_THROW(mapped.train(data, 2, 4));
+    ASSERT_NE(mapped.parameters(), m.parameters());
+}
+
+/* Check that files which are not checkpoints of the right type are refused */
+TEST(Checkpoint, CheckpointInvalid) {
+    auto path = checkpoint_path("invalid.ckpt");
+    std::remove(path.c_str());
+    ASSERT_THROW(load_model<double>(path), std::runtime_error);
+    ASSERT_THROW(map_model<double>(path), std::runtime_error);
+
+    std::ofstream(path) << std::string(sizeof(CheckpointHeader) + 8, '#');
+    ASSERT_THROW(load_model<double>(path), std::invalid_argument);
+    ASSERT_THROW(map_model<double>(path), std::invalid_argument);
+
+    save_model(make_model(), path);
+    ASSERT_THROW(load_model<float>(path), std::invalid_argument);
+    ASSERT_THROW(map_model<float>(path), std::invalid_argument);
+    ASSERT_EQ(map_model<double>(path).layer_number(), 3);
+
+    // crafted headers: unknown enums, sizes overflowing the bounds checks
+    auto check_corrupted = [&](std::size_t offset, auto value) {
+        save_model(make_model(), path);
+        overwrite(path, offset, value);
+        ASSERT_THROW(load_model<double>(path), std::invalid_argument);
+        ASSERT_THROW(map_model<double>(path), std::invalid_argument);
+    };
+    check_corrupted(offsetof(CheckpointHeader, loss), std::uint32_t(3));
+    check_corrupted(sizeof(CheckpointHeader) + 
+            offsetof(CheckpointLayer, activation), std::uint32_t(8));
+    check_corrupted(offsetof(CheckpointHeader, parameter_number), 
+            (std::uint64_t(1) << 61) + 1);
+    check_corrupted(offsetof(CheckpointHeader, layer_number), 
+            std::uint64_t(1) << 60);
+    check_corrupted(offsetof(CheckpointHeader, input_size), 
+            ~std::uint64_t(0));
+    check_corrupted(sizeof(CheckpointHeader), std::uint64_t(1) << 62);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,70 @@
+/*      test_dataset.cpp
+ *
+ *      Tests for the Dataset and DatasetView classes.
+ */
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "dataset.h"
+#include "model.h"
+using namespace my_nn;
+
+/* Check that instances are packed one per column */
+TEST(Dataset, DatasetPack) {
+    std::vector<std::pair<Vector, Vector>> instances(5);
+    for (int i = 0; i < 5; i++) {
+        instances[i] = std::pair(Vector::Constant(3, i), Vector::Constant(1, -i));
+    }
+    Dataset d(instances);
+    ASSERT_EQ(d.size(), 5);
+    ASSERT_EQ(d.features().rows(), 3);
+    ASSERT_EQ(d.labels().rows(), 1);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(d.features()(2, i), i);
+        ASSERT_EQ(d.labels()(0, i), -i);
+    }
+}
+
+/* Check that mismatched features and labels are rejected */
+TEST(Dataset, DatasetMismatch) {
+    ASSERT_THROW(Dataset(Matrix::Zero(3, 5), Matrix::Zero(1, 4)), 
+            std::invalid_argument);
+}
+
+/* Check that a view reads the storage of the dataset without copying it */
+TEST(Dataset, DatasetViewNoCopy) {
+    Dataset d(Matrix::Random(4, 10), Matrix::Random(2, 10));
+    DatasetView v = d;
+    ASSERT_EQ(v.size(), 10);
+    ASSERT_EQ(v.feature_size(), 4);
+    ASSERT_EQ(v.label_size(), 2);
+    ASSERT_EQ(v.features().data(), d.features().data());
+    ASSERT_EQ(v.labels().data(), d.labels().data());
+}
+
+/* Check that training on a dataset reduces the error */
+TEST(Dataset, DatasetTraining) {
+    std::default_random_engine generator;
+    std::uniform_real_distribution<elem_type> distribution_x(0.0, 1.0);
+    Matrix features(1, 100);
+    Matrix labels(1, 100);
+    for (int i = 0; i < 100; i++) {
+        auto x = distribution_x(generator);
+        features(0, i) = x;
+        labels(0, i) = x*x + 1.0;
+    }
+    Dataset data(features, labels);
+
+    Model m(1);
+    m.add_layer(10, Activation::ReLU);
+    m.add_layer(1);
+    m.set_loss(LossFunction::LstSq);
+    auto initial_loss = (m.forward(data.features()) - data.labels()).squaredNorm();
+    m.train(data, 20, 4);
+    auto final_loss = (m.forward(data.features()) - data.labels()).squaredNorm();
+
+    auto compare = [] (elem_type a, elem_type b) { return a < b; };
+    EXPECT_PRED2(compare, final_loss, initial_loss);
+}
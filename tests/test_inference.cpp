@@ -0,0 +1,85 @@
+/*      test_inference.cpp
+ *
+ *      Tests for the InferenceContext class and the allocation-free 
+ *      inference. Built against the library compiled with 
+ *      EIGEN_RUNTIME_NO_MALLOC.
+ */
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "inference.h"
+#include "model.h"
+#include "plan.h"
+using namespace my_nn;
+
+namespace {
+
+Model make_model() {
+    Model m(8);
+    m.add_layer(32, Activation::ReLU);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(3);
+    return m;
+}
+
+}
+
+/* Check that the context is sized after the widest layer */
+TEST(InferenceContext, ContextConstruct) {
+    Model m = make_model();
+    InferenceContext context(m, 4);
+    ASSERT_EQ(context.width(), 32);
+    ASSERT_EQ(context.batch_size(), 4);
+    ASSERT_EQ(InferenceContext(m.freeze()).width(), 32);
+    ASSERT_THROW(InferenceContext(m, 0), std::invalid_argument);
+}
+
+/* Check that inference in a context gives the same outputs, for a single
+ * input and for batches up to the size of the context */
+TEST(InferenceContext, ContextForward) {
+    Model m = make_model();
+    InferenceContext context(m, 10);
+    Matrix inputs = Matrix::Random(8, 10);
+    Matrix expected = m.forward(inputs);
+    ASSERT_NEAR((m.forward(inputs, context) - expected).norm(), 0.0, 1e-12);
+    ASSERT_NEAR((m.forward(inputs.leftCols(3), context) - 
+                expected.leftCols(3)).norm(), 0.0, 1e-12);
+    Vector input = inputs.col(4);
+    ASSERT_NEAR((m.forward(input, context).col(0) - m(input)).norm(), 0.0, 
+            1e-12);
+    ASSERT_THROW(m.forward(Matrix::Random(8, 11), context), 
+            std::invalid_argument);
+    InferenceContext narrow(16, 10);
+    ASSERT_THROW(m.forward(inputs, narrow), std::invalid_argument);
+}
+
+/* Check that inference in a context does not allocate, for the model and
+ * its plan */
+TEST(InferenceContext, ContextNoMalloc) {
+    Model m = make_model();
+    InferencePlan plan = m.freeze();
+    InferenceContext context(m, 16);
+    Matrix inputs = Matrix::Random(8, 16);
+    Matrix outputs(3, 16);
+    Vector input = Vector::Random(8);
+    Vector output(3);
+
+    Eigen::internal::set_is_malloc_allowed(false);
+    outputs = m.forward(inputs, context);
+    outputs = plan.forward(inputs, context);
+    output = m.forward(input, context).col(0);
+    output = plan.forward(input, context).col(0);
+    Eigen::internal::set_is_malloc_allowed(true);
+    ASSERT_NEAR((outputs - m.forward(inputs)).norm(), 0.0, 1e-12);
+    ASSERT_NEAR((output - m(input)).norm(), 0.0, 1e-12);
+}
+
+/* Check that a model or a plan without layers copies its inputs */
+TEST(InferenceContext, ContextEmpty) {
+    Model m(4);
+    Matrix inputs = Matrix::Random(4, 2);
+    ASSERT_EQ(m.forward(inputs), inputs);
+    ASSERT_EQ(m.freeze().forward(inputs), inputs);
+}
@@ -30,3 +30,50 @@ TEST(Layer, Layer0Stable) {
     }
 }
     
+
+/* Check that the batched application agrees with the application on each
+ * sample.
+ */
+TEST(Layer, LayerForwardBatch) {
+    Layer l(10, 20, Activation::ReLU);
+    Matrix inputs = Matrix::Random(10, 7);
+    auto outputs = l.forward(inputs);
+    ASSERT_EQ(outputs.rows(), 20);
+    ASSERT_EQ(outputs.cols(), 7);
+    for (int j = 0; j < inputs.cols(); j++) {
+        Vector single = l(inputs.col(j));
+        for (int i = 0; i < single.size(); i++) {
+            ASSERT_NEAR(outputs(i, j), single(i), 1e-10);
+        }
+    }
+}
+
+/* Check that the weights and bias are laid out in one buffer, and that copies
+ * get their own.
+ */
+TEST(Layer, LayerParameters) {
+    Layer l(3, 4);
+    ASSERT_EQ(l.parameter_number(), 16);
+    ASSERT_EQ(l.bias().data(), l.weights().data() + 12);
+    l.parameters().setConstant(1.0);
+    ASSERT_EQ(l.weights()(3, 2), 1.0);
+    ASSERT_EQ(l.bias()(3), 1.0);
+
+    Layer copy(l);
+    ASSERT_NE(copy.weights().data(), l.weights().data());
+    copy.weights()(0, 0) = 2.0;
+    ASSERT_EQ(l.weights()(0, 0), 1.0);
+}
+
+/* Check that single precision layers work like the double precision ones */
+TEST(Layer, LayerFloat) {
+    BasicLayer<float> l(10, 20, Activation::ReLU);
+    MatrixT<float> inputs = MatrixT<float>::Random(10, 3);
+    auto outputs = l.forward(inputs);
+    for (int j = 0; j < inputs.cols(); j++) {
+        VectorT<float> single = l(inputs.col(j));
+        for (int i = 0; i < single.size(); i++) {
+            ASSERT_NEAR(outputs(i, j), single(i), 1e-5);
+        }
+    }
+}
@@ -0,0 +1,175 @@
+/*      test_loss.cpp
+ *
+ *      Tests for the loss functions and their kernels.
+ */
+
+#include <cmath>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "layer.h"
+#include "loss.h"
+#include "model.h"
+using namespace my_nn;
+
+namespace {
+
+/* The loss of `pre` (before the bias) through `kernels`, on a copy. */
+double loss_of(const LossKernels<double> &kernels, const Matrix &pre, 
+        const Vector &bias, const Matrix &targets) {
+    Matrix act = pre;
+    return kernels.loss(act, bias, targets);
+}
+
+/* Checks the deltas of `kernels` against central differences of `factor`
+ * times the loss, and that both kernels agree on the loss and the outputs. */
+void check_deltas(const LossKernels<double> &kernels, const Matrix &pre,
+        const Vector &bias, const Matrix &targets, double scale, 
+        double factor = 1.0) {
+    Matrix act = pre;
+    Matrix delta(pre.rows(), pre.cols());
+    double loss = kernels.loss_delta(act, bias, targets, delta, scale);
+    Matrix outputs = pre;
+    ASSERT_NEAR(loss, kernels.loss(outputs, bias, targets), 1e-12);
+    ASSERT_TRUE(act.isApprox(outputs));
+    const double h = 1e-6;
+    for (Eigen::Index j = 0; j < pre.cols(); j++) {
+        for (Eigen::Index i = 0; i < pre.rows(); i++) {
+            Matrix plus = pre, minus = pre;
+            plus(i, j) += h;
+            minus(i, j) -= h;
+            double numeric = (loss_of(kernels, plus, bias, targets) - 
+                    loss_of(kernels, minus, bias, targets)) / (2 * h);
+            ASSERT_NEAR(delta(i, j), numeric * scale * factor, 1e-6);
+        }
+    }
+}
+
+} // namespace
+
+/* Check the fused binary cross-entropy against its definition, and its 
+ * deltas against the derivative of the loss. */
+TEST(Loss, SigmoidCrossEntropy) {
+    auto &kernels = loss_kernels<double>(LossFunction::LogLoss, 
+            Activation::Sigmoid);
+    Matrix pre = Matrix::Random(5, 3) * 3.0;
+    Vector bias = Vector::Random(5);
+    Matrix targets = (Matrix::Random(5, 3).array() + 1.0) / 2.0;
+    Matrix act = pre;
+    double loss = kernels.loss(act, bias, targets);
+    Matrix p = (1.0 + (-(pre.colwise() + bias).array()).exp()).inverse();
+    double expected = -(targets.array() * p.array().log() + 
+            (1.0 - targets.array()) * (1.0 - p.array()).log()).sum();
+    ASSERT_NEAR(loss, expected, 1e-10);
+    ASSERT_TRUE(act.isApprox(p));
+    check_deltas(kernels, pre, bias, targets, 0.5);
+}
+
+/* Check that the binary cross-entropy stays finite and exact where the 
+ * sigmoid saturates. */
+TEST(Loss, SigmoidCrossEntropySaturated) {
+    auto &kernels = loss_kernels<float>(LossFunction::LogLoss, 
+            Activation::Sigmoid);
+    MatrixT<float> act(2, 1);
+    act << 100.0f, -100.0f;
+    VectorT<float> bias = VectorT<float>::Zero(2);
+    MatrixT<float> targets(2, 1);
+    targets << 0.0f, 0.0f;
+    MatrixT<float> delta(2, 1);
+    float loss = kernels.loss_delta(act, bias, targets, delta, 1.0f);
+    ASSERT_TRUE(std::isfinite(loss));
+    ASSERT_NEAR(loss, 100.0f, 1e-4f);
+    ASSERT_FLOAT_EQ(delta(0, 0), 1.0f);
+    ASSERT_NEAR(delta(1, 0), 0.0f, 1e-30f);
+}
+
+/* Check the fused categorical cross-entropy against its definition, its
+ * deltas, and its stability on large pre-activations. */
+TEST(Loss, SoftmaxCrossEntropy) {
+    auto &kernels = loss_kernels<double>(LossFunction::LogLoss, 
+            Activation::Softmax);
+    Matrix pre = Matrix::Random(4, 3) * 3.0;
+    Vector bias = Vector::Random(4);
+    Matrix targets = Matrix::Zero(4, 3);
+    targets(0, 0) = 1.0;
+    targets(3, 1) = 1.0;
+    targets(1, 2) = 0.25;
+    targets(2, 2) = 0.75;
+    Matrix act = pre;
+    double loss = kernels.loss(act, bias, targets);
+    Matrix e = (pre.colwise() + bias).array().exp();
+    Matrix p = e.array().rowwise() / e.colwise().sum().array();
+    ASSERT_NEAR(loss, -(targets.array() * p.array().log()).sum(), 1e-10);
+    ASSERT_TRUE(act.isApprox(p));
+    check_deltas(kernels, pre, bias, targets, 1.0 / 3.0);
+
+    Matrix large(3, 1);
+    large << 1000.0, 0.0, -1000.0;
+    Matrix onehot(3, 1);
+    onehot << 0.0, 1.0, 0.0;
+    ASSERT_NEAR(loss_of(kernels, large, Vector::Zero(3), onehot), 1000.0, 
+            1e-9);
+}
+
+/* Check the deltas of the squared error through the activations, softmax's
+ * mixing its outputs. */
+TEST(Loss, SquaresDeltas) {
+    Matrix pre = Matrix::Random(4, 3);
+    Vector bias = Vector::Random(4);
+    Matrix targets = Matrix::Random(4, 3);
+    for (auto activation : {Activation::None, Activation::Sigmoid, 
+            Activation::Softmax}) {
+        auto &kernels = loss_kernels<double>(LossFunction::LstSq, activation);
+        // the deltas are those of half the squared error
+        check_deltas(kernels, pre, bias, targets, 2.0, 0.5);
+    }
+}
+
+/* Check that the log loss needs outputs that are probabilities. */
+TEST(Loss, LogLossPairing) {
+    ASSERT_THROW(loss_kernels<double>(LossFunction::LogLoss, Activation::None),
+            std::invalid_argument);
+    ASSERT_THROW(loss_kernels<double>(LossFunction::Unset, Activation::None),
+            std::invalid_argument);
+    Model m(3);
+    m.add_layer(4, Activation::Softmax);
+    m.add_layer(2, Activation::Softmax);
+    m.set_loss(LossFunction::LogLoss);
+    Vector input = Vector::Random(3);
+    Vector label = Vector::Random(2);
+    ASSERT_THROW(m.gradient(input, label), std::invalid_argument);
+}
+
+/* Check that a classifier trained on the cross-entropy gets the gradient of
+ * its score, and reports the loss of its batches. */
+TEST(Loss, ModelCrossEntropyGradient) {
+    Model m(3);
+    m.add_layer(5, Activation::Sigmoid);
+    m.add_layer(4, Activation::Softmax);
+    m.set_loss(LossFunction::LogLoss);
+    Matrix inputs = Matrix::Random(3, 2);
+    Matrix targets = Matrix::Zero(4, 2);
+    targets(1, 0) = 1.0;
+    targets(3, 1) = 1.0;
+    Workspace workspace(m, 2);
+    m.gradient(inputs, targets, workspace);
+    auto score = [&]() {
+        return m.score(inputs.col(0), targets.col(0)) + 
+            m.score(inputs.col(1), targets.col(1));
+    };
+    ASSERT_NEAR(workspace.loss(), score(), 1e-12);
+    const double h = 1e-6;
+    auto parameters = m.parameters();
+    for (Eigen::Index k = 0; k < parameters.size(); k++) {
+        double saved = parameters(k);
+        parameters(k) = saved + h;
+        double plus = score();
+        parameters(k) = saved - h;
+        double minus = score();
+        parameters(k) = saved;
+        // the gradient is averaged over the batch of 2
+        ASSERT_NEAR(workspace.flat_gradients()(k), (plus - minus) / (4 * h), 
+                1e-6);
+    }
+}
@@ -0,0 +1,148 @@
+/*      test_mapped_dataset.cpp
+ *
+ *      Tests for the dataset file format and the MappedDataset class.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+
+#include "dataset.h"
+#include "mapped_dataset.h"
+#include "model.h"
+#include "optimizer.h"
+using namespace my_nn;
+
+namespace {
+
+std::string dataset_path(const std::string &name) {
+    return ::testing::TempDir() + name;
+}
+
+/* Overwrites the bytes of `value` at `offset` in the file at `path` */
+template <typename T>
+void overwrite(const std::string &path, std::size_t offset, T value) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+}
+
+/* Check that a saved dataset maps back with the same instances */
+TEST(MappedDataset, MappedDatasetRoundTrip) {
+    Dataset d(Matrix::Random(3, 10), Matrix::Random(2, 10));
+    auto path = dataset_path("round_trip.data");
+    save_dataset(d.view(), path);
+    MappedDataset mapped(path);
+    ASSERT_EQ(mapped.size(), 10);
+    ASSERT_EQ(mapped.view().feature_size(), 3);
+    ASSERT_EQ(mapped.view().label_size(), 2);
+    ASSERT_EQ(mapped.view().features(), d.features());
+    ASSERT_EQ(mapped.view().labels(), d.labels());
+    std::remove(path.c_str());
+}
+
+/* Check that a dataset written in chunks, here of columns which are not 
+ * contiguous, is the same as the whole dataset. */
+TEST(MappedDataset, MappedDatasetWriter) {
+    Matrix features = Matrix::Random(4, 9);
+    Matrix labels = Matrix::Random(1, 9);
+    auto path = dataset_path("writer.data");
+    DatasetWriter writer(path, 9, 3, 1);
+    writer.append(features.topRows(3).leftCols(5), labels.leftCols(5));
+    ASSERT_THROW(writer.append(features.leftCols(4), labels.leftCols(4)),
+            std::invalid_argument);
+    ASSERT_THROW(writer.append(features.topRows(3), labels), 
+            std::invalid_argument);
+    writer.append(features.topRows(3).rightCols(4), labels.rightCols(4));
+    ASSERT_EQ(writer.written(), 9);
+    writer.close();
+
+    MappedDataset mapped(path);
+    ASSERT_EQ(mapped.view().features(), features.topRows(3));
+    ASSERT_EQ(mapped.view().labels(), labels);
+    std::remove(path.c_str());
+}
+
+/* Check that an incomplete dataset is reported */
+TEST(MappedDataset, MappedDatasetIncomplete) {
+    auto path = dataset_path("incomplete.data");
+    DatasetWriter writer(path, 4, 2, 1);
+    writer.append(Matrix::Zero(2, 3), Matrix::Zero(1, 3));
+    ASSERT_THROW(writer.close(), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+/* Check that slices are views of consecutive instances */
+TEST(MappedDataset, MappedDatasetSlice) {
+    Dataset d(Matrix::Random(3, 10), Matrix::Random(2, 10));
+    auto path = dataset_path("slice.data");
+    save_dataset(d.view(), path);
+    MappedDataset mapped(path);
+    auto batch = mapped.view().slice(4, 3);
+    ASSERT_EQ(batch.size(), 3);
+    ASSERT_EQ(batch.features().data(), mapped.view().features().col(4).data());
+    ASSERT_EQ(batch.features(), d.features().middleCols(4, 3));
+    ASSERT_EQ(batch.labels(), d.labels().middleCols(4, 3));
+    ASSERT_EQ(mapped.view().slice(10, 0).size(), 0);
+    ASSERT_THROW(mapped.view().slice(8, 3), std::invalid_argument);
+    std::remove(path.c_str());
+}
+
+/* Check that a model trains on a mapped dataset, which outlives its move */
+TEST(MappedDataset, MappedDatasetTraining) {
+    Matrix x = Matrix::Random(2, 200);
+    Matrix y = x.colwise().sum();
+    auto path = dataset_path("training.data");
+    save_dataset(Dataset(x, y).view(), path);
+    MappedDataset opened(path);
+    MappedDataset mapped(std::move(opened));
+    std::remove(path.c_str());
+
+    Model m(2);
+    m.add_layer(1);
+    m.set_loss(LossFunction::LstSq);
+    elem_type before = (m.forward(x) - y).squaredNorm();
+    SGD sgd(0.1);
+    m.train(mapped, 20, 10, sgd);
+    ASSERT_LT((m.forward(x) - y).squaredNorm(), before);
+}
+
+/* Check that files which are not datasets of the right type are refused */
+TEST(MappedDataset, MappedDatasetInvalid) {
+    auto path = dataset_path("invalid.data");
+    std::remove(path.c_str());
+    ASSERT_THROW(MappedDataset{path}, std::runtime_error);
+
+    std::ofstream(path) << "not a dataset, but long enough to hold a header of "
+        "a dataset file";
+    ASSERT_THROW(MappedDataset{path}, std::invalid_argument);
+
+    save_dataset(Dataset(Matrix::Zero(3, 4), Matrix::Zero(1, 4)).view(), path);
+    ASSERT_THROW(BasicMappedDataset<float>{path}, std::invalid_argument);
+    ASSERT_EQ(MappedDataset{path}.size(), 4);
+
+    // crafted headers: sizes whose byte counts overflow the bounds checks
+    auto check_corrupted = [&](std::size_t size, std::size_t feature_size,
+            std::size_t label_size) {
+        save_dataset(Dataset(Matrix::Zero(1, 1), Matrix::Zero(0, 1)).view(),
+                path);
+        overwrite(path, offsetof(DatasetHeader, size), std::uint64_t(size));
+        overwrite(path, offsetof(DatasetHeader, feature_size), 
+                std::uint64_t(feature_size));
+        overwrite(path, offsetof(DatasetHeader, label_size), 
+                std::uint64_t(label_size));
+        ASSERT_THROW(MappedDataset{path}, std::invalid_argument);
+    };
+    check_corrupted(std::size_t(1) << 61, 8, 0);
+    check_corrupted(std::size_t(1) << 61, 0, 8);
+    check_corrupted(1, std::size_t(1) << 63, 0);
+    check_corrupted(0, 1, ~std::size_t(0));
+    std::remove(path.c_str());
+}
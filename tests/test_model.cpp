@@ -3,7 +3,10 @@
  *      Tests for the Model class.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <random>
+#include <stdexcept>
 
 #include "gtest/gtest.h"
 
@@ -25,6 +28,30 @@ TEST(Model, ModelConstruct) {
     SUCCEED();
 }
 
+/* Check that the parameters of all the layers are stored in one buffer, and
+ * that copies of the model get their own.
+ */
+TEST(Model, ModelParameters) {
+    Model m(5);
+    m.add_layer(4, Activation::ReLU);
+    m.add_layer(3, Activation::ReLU);
+    m.add_layer(1);
+    auto parameters = m.parameters();
+    ASSERT_EQ(parameters.size(), 4*6 + 3*5 + 1*4);
+    ASSERT_EQ(m.get_layer(0).weights().data(), parameters.data());
+    ASSERT_EQ(m.get_layer(1).weights().data(), parameters.data() + 24);
+    ASSERT_EQ(m.get_layer(2).bias().data(), parameters.data() + 42);
+
+    parameters(24) = 3.0;
+    ASSERT_EQ(m.get_layer(1).weights()(0, 0), 3.0);
+
+    Model copy(m);
+    ASSERT_EQ(copy.get_layer(1).weights()(0, 0), 3.0);
+    ASSERT_EQ(copy.get_layer(1).weights().data(), copy.parameters().data() + 24);
+    copy.parameters().setZero();
+    ASSERT_EQ(m.get_layer(1).weights()(0, 0), 3.0);
+}
+
 /* Check the the loss function sets */
 TEST(Model, ModelLoss) {
     ASSERT_NO_THROW({
@@ -53,6 +80,26 @@ TEST(Model, Model0Stable) {
     ASSERT_NEAR(loss, 0.0, 1e-100);
 }
 
+/* Check that the batched forward pass agrees with the application of the model
+ * on each sample.
+ */
+TEST(Model, ModelForwardBatch) {
+    Model m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(4, Activation::ReLU);
+    m.add_layer(2);
+    Matrix inputs = Matrix::Random(8, 13);
+    auto outputs = m.forward(inputs);
+    ASSERT_EQ(outputs.rows(), 2);
+    ASSERT_EQ(outputs.cols(), 13);
+    for (int j = 0; j < inputs.cols(); j++) {
+        Vector single = m(inputs.col(j));
+        for (int i = 0; i < single.size(); i++) {
+            ASSERT_NEAR(outputs(i, j), single(i), 1e-10);
+        }
+    }
+}
+
 /* Check that the gradient procedure works by comparing with finite differences
  */
 TEST(Model, ModelGradient) {
@@ -71,6 +118,33 @@ TEST(Model, ModelGradient) {
     ASSERT_NEAR(gradient, var_grad, 0.01);
 }
 
+/* Check that the mini-batch gradient is the average of the gradients on each
+ * sample of the batch.
+ */
+TEST(Model, ModelGradientBatch) {
+    Model m(3);
+    m.add_layer(10, Activation::ReLU);
+    m.add_layer(5, Activation::ReLU);
+    m.add_layer(2);
+    m.set_loss(LossFunction::LstSq);
+    Matrix inputs = Matrix::Random(3, 6);
+    Matrix labels = Matrix::Random(2, 6);
+    auto batch = m.gradient(inputs, labels);
+    for (int k = 0; k < 3; k++) {
+        Matrix weights = Matrix::Zero(batch[k].first.rows(), batch[k].first.cols());
+        Vector bias = Vector::Zero(batch[k].second.size());
+        for (int j = 0; j < inputs.cols(); j++) {
+            Vector input = inputs.col(j);
+            Vector label = labels.col(j);
+            auto single = m.gradient(input, label);
+            weights += single[k].first / inputs.cols();
+            bias += single[k].second / inputs.cols();
+        }
+        ASSERT_NEAR((batch[k].first - weights).norm(), 0.0, 1e-10);
+        ASSERT_NEAR((batch[k].second - bias).norm(), 0.0, 1e-10);
+    }
+}
+
 /* Check that training reduces the error */
 TEST(Model, ModelTraining) {
     // Model
@@ -119,3 +193,164 @@ TEST(Model, ModelTraining) {
     auto compare = [] (elem_type a, elem_type b) { return a < b; };
     EXPECT_PRED2(compare, final_loss, initial_loss);
 }
+
+/* Check that mini-batch training reduces the error */
+TEST(Model, ModelTrainingBatch) {
+    Model m(1);
+    m.add_layer(10, Activation::ReLU);
+    m.add_layer(1);
+    m.set_loss(LossFunction::LstSq);
+
+    std::default_random_engine generator;
+    std::uniform_real_distribution<elem_type> distribution_x(0.0, 1.0);
+    std::vector<std::pair<Vector, Vector>> data(100);
+    for (auto &instance : data) {
+        auto x = distribution_x(generator);
+        instance = std::pair(Vector::Constant(1, x), Vector::Constant(1, x*x + 1.0));
+    }
+
+    auto loss = [&] () {
+        auto total = 0.0;
+        for (auto &instance : data) {
+            total += m.score(instance.first, instance.second);
+        }
+        return total / data.size();
+    };
+    auto initial_loss = loss();
+    m.train(data, 50, 8);
+    auto final_loss = loss();
+
+    auto compare = [] (elem_type a, elem_type b) { return a < b; };
+    EXPECT_PRED2(compare, final_loss, initial_loss);
+
+    // instances of other sizes are refused rather than copied out of bounds
+    ASSERT_THROW(m.train(Dataset(Matrix::Random(2, 10), Matrix::Random(1, 10)),
+                1, 4), std::invalid_argument);
+    ASSERT_THROW(m.train(Dataset(Matrix::Random(1, 10), Matrix::Random(3, 10)),
+                1, 4), std::invalid_argument);
+}
+
+/* Check that a model cast to single precision computes the same function */
+TEST(Model, ModelCastFloat) {
+    Model m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(2);
+    m.set_loss(LossFunction::LstSq);
+    BasicModel<float> f = m.cast<float>();
+    ASSERT_EQ(f.loss(), LossFunction::LstSq);
+    ASSERT_EQ(f.parameters().size(), m.parameters().size());
+    Matrix inputs = Matrix::Random(8, 5);
+    MatrixT<float> outputs = f.forward(inputs.cast<float>());
+    ASSERT_NEAR((outputs.cast<double>() - m.forward(inputs)).norm(), 0.0, 1e-4);
+}
+
+/* Check that training in single precision reduces the error */
+TEST(Model, ModelTrainingFloat) {
+    BasicModel<float> m(1);
+    m.add_layer(10, Activation::ReLU);
+    m.add_layer(1);
+    m.set_loss(LossFunction::LstSq);
+
+    MatrixT<float> features = MatrixT<float>::Random(1, 100);
+    MatrixT<float> labels = features.array().square() + 1.0f;
+    BasicDataset<float> data(features, labels);
+    auto initial_loss = (m.forward(features) - labels).squaredNorm();
+    BasicAdam<float> optimizer(0.01f);
+    m.train(data, 20, 8, optimizer);
+    auto final_loss = (m.forward(features) - labels).squaredNorm();
+
+    auto compare = [] (float a, float b) { return a < b; };
+    EXPECT_PRED2(compare, final_loss, initial_loss);
+}
+
+/* Check that the evaluation gives the mean of the scores of the instances,
+ * whatever the number of threads and the batch size */
+TEST(Model, ModelEvaluate) {
+    Model m(4);
+    m.add_layer(8, Activation::ReLU);
+    m.add_layer(3);
+    m.set_loss(LossFunction::LstSq);
+    Dataset data(Matrix::Random(4, 101), Matrix::Random(3, 101));
+    elem_type loss = 0.0;
+    for (int i = 0; i < 101; i++) {
+        loss += m.score(data.features().col(i), data.labels().col(i));
+    }
+    for (std::size_t threads : {1, 2, 3}) {
+        for (std::size_t batch : {1, 16, 256}) {
+            auto result = m.evaluate(data, threads, batch);
+            ASSERT_EQ(result.size, 101);
+            ASSERT_NEAR(result.loss, loss / 101, 1e-12);
+            ASSERT_EQ(result.confusion.sum(), 101);
+        }
+    }
+    ASSERT_THROW(m.evaluate(Dataset(Matrix::Zero(3, 2), Matrix::Zero(3, 2))),
+            std::invalid_argument);
+}
+
+/* Check the classification metrics */
+TEST(Model, ModelEvaluateClasses) {
+    // the output is the input: the predicted class is the largest feature
+    Model m(3);
+    m.add_layer(3);
+    m.parameters().setZero();
+    m.get_layer(0).weights().setIdentity();
+    m.set_loss(LossFunction::LstSq);
+    Matrix features(3, 4);
+    features << 1, 0, 0, 0,
+                0, 1, 1, 0,
+                0, 0, 0, 1;
+    Matrix labels(3, 4);
+    labels << 1, 0, 1, 0,
+              0, 1, 0, 0,
+              0, 0, 0, 1;
+    auto result = m.evaluate(Dataset(features, labels), 2);
+    ASSERT_EQ(result.accuracy, 0.75);
+    Evaluation::ConfusionMatrix expected(3, 3);
+    expected << 1, 1, 0,
+                0, 1, 0,
+                0, 0, 1;
+    ASSERT_EQ(result.confusion, expected);
+
+    // a single label is a binary class
+    Model binary(1);
+    binary.add_layer(1);
+    binary.parameters() << 1, 0;
+    binary.set_loss(LossFunction::LstSq);
+    Matrix x(1, 3);
+    x << 0.2, 0.7, 0.9;
+    Matrix y(1, 3);
+    y << 0, 0, 1;
+    auto binary_result = binary.evaluate(Dataset(x, y));
+    ASSERT_EQ(binary_result.confusion.rows(), 2);
+    ASSERT_EQ(binary_result.confusion(0, 1), 1);
+    ASSERT_EQ(binary_result.confusion(1, 1), 1);
+}
+
+/* Check that pruning zeroes the smallest weights of each layer and keeps the
+ * biases.
+ */
+TEST(Model, ModelPrune) {
+    Model m(10);
+    m.add_layer(20, Activation::ReLU);
+    m.add_layer(5);
+    m.get_layer(0).bias().setOnes();
+    const Matrix before = m.get_layer(1).weights();
+    m.prune(0.9);
+    ASSERT_EQ((m.get_layer(0).weights().array() == 0).count(), 180);
+    ASSERT_EQ((m.get_layer(1).weights().array() == 0).count(), 90);
+    ASSERT_EQ(m.get_layer(0).bias(), Vector::Ones(20));
+    // the kept weights are unchanged and no smaller than the pruned ones
+    const Matrix after = m.get_layer(1).weights();
+    elem_type smallest_kept = 1e9, largest_pruned = 0;
+    for (Eigen::Index k = 0; k < after.size(); k++) {
+        if (after(k) != 0) {
+            ASSERT_EQ(after(k), before(k));
+            smallest_kept = std::min(smallest_kept, std::abs(after(k)));
+        } else {
+            largest_pruned = std::max(largest_pruned, std::abs(before(k)));
+        }
+    }
+    ASSERT_LE(largest_pruned, smallest_kept);
+    ASSERT_THROW(m.prune(1.5), std::invalid_argument);
+    ASSERT_THROW(m.prune(-0.1), std::invalid_argument);
+}
@@ -0,0 +1,103 @@
+/*      test_optimizer.cpp
+ *
+ *      Tests for the Optimizer classes.
+ */
+
+#include <memory>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "model.h"
+#include "optimizer.h"
+#include "workspace.h"
+using namespace my_nn;
+
+namespace {
+
+/* Noisy samples of x^2 + 1 on [0, 1] */
+Dataset parabola(std::size_t size) {
+    std::default_random_engine generator;
+    std::uniform_real_distribution<elem_type> distribution_x(0.0, 1.0);
+    std::normal_distribution<elem_type> distribution_noise(0.0, 0.01);
+    Matrix features(1, size);
+    Matrix labels(1, size);
+    for (std::size_t i = 0; i < size; i++) {
+        auto x = distribution_x(generator);
+        features(0, i) = x;
+        labels(0, i) = x*x + 1.0 + distribution_noise(generator);
+    }
+    return Dataset(features, labels);
+}
+
+Model small_model() {
+    Model m(1);
+    m.add_layer(10, Activation::ReLU);
+    m.add_layer(1);
+    m.set_loss(LossFunction::LstSq);
+    return m;
+}
+
+elem_type mean_loss(const Model &m, const Dataset &data) {
+    return (m.forward(data.features()) - data.labels()).squaredNorm() / data.size();
+}
+
+} // namespace
+
+/* Check that one SGD step is param -= rate * grad, including on the tail of
+ * the tensors that does not fill a SIMD packet.
+ */
+TEST(Optimizer, SGDStep) {
+    Model m(3);
+    m.add_layer(7, Activation::ReLU);
+    m.add_layer(1);
+    Workspace w(m, 4);
+    Matrix inputs = Matrix::Random(3, 4);
+    Matrix labels = Matrix::Random(1, 4);
+    m.gradient(inputs, labels, w);
+    Matrix weights = m.get_layer(0).weights();
+    Vector bias = m.get_layer(1).bias();
+    SGD optimizer(0.1);
+    optimizer.step(m, w);
+    Matrix expected_weights = weights - 0.1 * w.gradients()[0].first;
+    Vector expected_bias = bias - 0.1 * w.gradients()[1].second;
+    ASSERT_NEAR((m.get_layer(0).weights() - expected_weights).norm(), 0.0, 1e-12);
+    ASSERT_NEAR((m.get_layer(1).bias() - expected_bias).norm(), 0.0, 1e-12);
+}
+
+/* Check that the first Adam step moves every parameter with a non-zero 
+ * gradient by the learning rate, against the gradient.
+ */
+TEST(Optimizer, AdamFirstStep) {
+    Model m(3);
+    m.add_layer(5);
+    Workspace w(m, 2);
+    m.gradient(Matrix::Random(3, 2), Matrix::Random(5, 2), w);
+    Matrix weights = m.get_layer(0).weights();
+    Adam optimizer(0.01, 0.9, 0.999, 0.0);
+    optimizer.step(m, w);
+    Matrix moved = m.get_layer(0).weights() - weights;
+    auto &grad = w.gradients()[0].first;
+    for (int i = 0; i < moved.size(); i++) {
+        ASSERT_NEAR(moved(i), grad(i) > 0 ? -0.01 : 0.01, 1e-9);
+    }
+}
+
+/* Check that training with each optimizer reduces the error */
+TEST(Optimizer, OptimizersTraining) {
+    auto data = parabola(200);
+    std::vector<std::unique_ptr<Optimizer>> optimizers;
+    optimizers.push_back(std::make_unique<SGD>(0.1));
+    optimizers.push_back(std::make_unique<Momentum>(0.05));
+    optimizers.push_back(std::make_unique<Nesterov>(0.05));
+    optimizers.push_back(std::make_unique<RMSProp>(0.01));
+    optimizers.push_back(std::make_unique<Adam>(0.01));
+    for (auto &optimizer : optimizers) {
+        auto m = small_model();
+        auto initial_loss = mean_loss(m, data);
+        m.train(data, 20, 8, *optimizer);
+        auto final_loss = mean_loss(m, data);
+        auto compare = [] (elem_type a, elem_type b) { return a < b; };
+        EXPECT_PRED2(compare, final_loss, initial_loss);
+    }
+}
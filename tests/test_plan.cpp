@@ -0,0 +1,162 @@
+/*      test_plan.cpp
+ *
+ *      Tests for the InferencePlan class.
+ */
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "model.h"
+#include "plan.h"
+using namespace my_nn;
+
+/* Check that a frozen model computes the same outputs */
+TEST(InferencePlan, PlanOutputs) {
+    Model m(6);
+    m.add_layer(8, Activation::ReLU);
+    m.add_layer(8);
+    m.add_layer(4, Activation::ReLU);
+    m.add_layer(2);
+    InferencePlan plan = m.freeze();
+    ASSERT_EQ(plan.input(), 6);
+    Matrix inputs = Matrix::Random(6, 10);
+    ASSERT_NEAR((plan.forward(inputs) - m.forward(inputs)).norm(), 0.0, 1e-12);
+    ASSERT_NEAR((plan(inputs.col(3)) - m(inputs.col(3))).norm(), 0.0, 1e-12);
+    ASSERT_THROW(plan.forward(Matrix::Random(5, 2)), std::invalid_argument);
+}
+
+/* Check that consecutive affine layers are folded into one */
+TEST(InferencePlan, PlanFold) {
+    Model m(16);
+    m.add_layer(16);
+    m.add_layer(16);
+    m.add_layer(4, Activation::ReLU);
+    InferencePlan plan = m.freeze();
+    ASSERT_EQ(plan.step_number(), 1);
+    ASSERT_EQ(plan.cost(), 4 * 16);
+    ASSERT_EQ(plan.get_step(0).activation, Activation::ReLU);
+    Matrix inputs = Matrix::Random(16, 5);
+    ASSERT_NEAR((plan.forward(inputs) - m.forward(inputs)).norm(), 0.0, 1e-12);
+}
+
+/* Check that a bottleneck is kept: the product of its weights would cost 
+ * more than both layers */
+TEST(InferencePlan, PlanBottleneck) {
+    Model m(32);
+    m.add_layer(2);
+    m.add_layer(32);
+    InferencePlan plan = m.freeze();
+    ASSERT_EQ(plan.step_number(), 2);
+    ASSERT_EQ(plan.cost(), 2 * 32 * 2);
+}
+
+/* Check that identity layers are dropped */
+TEST(InferencePlan, PlanIdentity) {
+    Model m(4);
+    m.add_layer(4, Activation::ReLU);
+    m.add_layer(4);
+    m.get_layer(1).weights().setIdentity();
+    m.get_layer(1).bias().setZero();
+    m.add_layer(3, Activation::ReLU);
+    InferencePlan plan = m.freeze();
+    ASSERT_EQ(plan.step_number(), 2);
+    Matrix inputs = Matrix::Random(4, 5);
+    ASSERT_NEAR((plan.forward(inputs) - m.forward(inputs)).norm(), 0.0, 1e-12);
+}
+
+/* Check that a normalization of the inputs is folded into the first layer */
+TEST(InferencePlan, PlanNormalization) {
+    Model m(3);
+    m.add_layer(5, Activation::ReLU);
+    m.add_layer(1);
+    Vector mean(3), scale(3);
+    mean << 1.0, -2.0, 0.5;
+    scale << 0.5, 2.0, 4.0;
+    InferencePlan plan = m.freeze(mean, scale);
+    ASSERT_EQ(plan.step_number(), 2);
+    Matrix inputs = Matrix::Random(3, 7);
+    Matrix normalized = (inputs.colwise() - mean).array().colwise() * 
+        scale.array();
+    ASSERT_NEAR((plan.forward(inputs) - m.forward(normalized)).norm(), 0.0, 
+            1e-12);
+    ASSERT_THROW(m.freeze(Vector::Zero(2), Vector::Ones(3)), 
+            std::invalid_argument);
+}
+
+/* Check that a layer of low rank is split in its two factors, and that 
+ * compressing without loss keeps the layers of full rank */
+TEST(InferencePlan, PlanCompressRank) {
+    Model m(64);
+    m.add_layer(64, Activation::ReLU);
+    m.add_layer(8);
+    m.get_layer(0).weights() = Matrix::Random(64, 4) * Matrix::Random(4, 64);
+    InferencePlan plan = m.freeze();
+    plan.compress(1.0 - 1e-9);
+    ASSERT_EQ(plan.step_number(), 3);
+    ASSERT_EQ(plan.get_step(0).weights.rows(), 4);
+    ASSERT_EQ(plan.get_step(1).activation, Activation::ReLU);
+    ASSERT_EQ(plan.cost(), 4 * 64 + 64 * 4 + 8 * 64);
+    Matrix inputs = Matrix::Random(64, 10);
+    ASSERT_NEAR((plan.forward(inputs) - m.forward(inputs)).norm(), 0.0, 1e-9);
+
+    Model full(64);
+    full.add_layer(64, Activation::ReLU);
+    InferencePlan exact = full.freeze();
+    exact.compress(1.0);
+    ASSERT_EQ(exact.step_number(), 1);
+    ASSERT_THROW(exact.compress(0.0), std::invalid_argument);
+}
+
+/* Check that the compression on calibration inputs keeps the error of a 
+ * linear model within the tolerance */
+TEST(InferencePlan, PlanCompressCalibration) {
+    Model m(100);
+    m.add_layer(100);
+    // singular values decaying as 1/i
+    Eigen::BDCSVD<Matrix> svd(Matrix(Matrix::Random(100, 100)), 
+            Eigen::ComputeThinU | Eigen::ComputeThinV);
+    Vector decay = Vector::LinSpaced(100, 1, 100).cwiseInverse();
+    m.get_layer(0).weights() = svd.matrixU() * decay.asDiagonal() * 
+        svd.matrixV().transpose();
+    Matrix calibration = Matrix::Random(100, 200);
+    InferencePlan plan = m.freeze();
+    plan.compress(calibration, 0.1);
+    ASSERT_EQ(plan.step_number(), 2);
+    ASSERT_LT(plan.cost(), 100 * 100);
+    Matrix expected = m.forward(calibration);
+    auto error = (plan.forward(calibration) - expected).norm() / 
+        expected.norm();
+    ASSERT_LE(error, 0.1);
+    ASSERT_GT(error, 0.05);
+    ASSERT_THROW(plan.compress(Matrix::Random(3, 2), 0.1), 
+            std::invalid_argument);
+}
+
+/* Check that a pruned model gets sparse steps which compute the same 
+ * outputs with fewer multiply-adds and less memory */
+TEST(InferencePlan, PlanSparse) {
+    Model m(64);
+    m.add_layer(64, Activation::ReLU);
+    m.add_layer(64, Activation::ReLU);
+    m.add_layer(4);
+    m.prune(0.9);
+    InferencePlan dense = m.freeze();
+    InferencePlan plan = m.freeze();
+    plan.sparsify();
+    ASSERT_EQ(plan.step_number(), 3);
+    ASSERT_FALSE(dense.get_step(0).sparse);
+    ASSERT_TRUE(plan.get_step(0).sparse);
+    ASSERT_TRUE(plan.get_step(2).sparse);
+    ASSERT_EQ(plan.get_step(0).nodes(), 64);
+    ASSERT_LT(plan.cost(), dense.cost() / 5);
+    ASSERT_LT(plan.parameter_bytes(), dense.parameter_bytes() / 3);
+    Matrix inputs = Matrix::Random(64, 10);
+    ASSERT_NEAR((plan.forward(inputs) - m.forward(inputs)).norm(), 0.0, 1e-12);
+    ASSERT_NEAR((plan(inputs.col(2)) - m(inputs.col(2))).norm(), 0.0, 1e-12);
+
+    // the sparse steps are left as they are by the compression
+    plan.compress(0.5);
+    ASSERT_TRUE(plan.get_step(0).sparse);
+    ASSERT_THROW(InferenceContext(plan, 2).check(65, 2), std::invalid_argument);
+}
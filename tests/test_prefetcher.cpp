@@ -0,0 +1,87 @@
+/*      test_prefetcher.cpp
+ *
+ *      Tests for the Prefetcher class.
+ */
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "dataset.h"
+#include "model.h"
+#include "optimizer.h"
+#include "prefetcher.h"
+#include "workspace.h"
+using namespace my_nn;
+
+/* Check that each batch is made of instances of the dataset */
+TEST(Prefetcher, PrefetcherBatches) {
+    // instance i has features (i, i, i) and label -i
+    Matrix features = Eigen::RowVectorXd::LinSpaced(10, 0, 9).replicate(3, 1);
+    Dataset d(features, -features.topRows(1));
+    Prefetcher prefetcher(d.view(), 4);
+    ASSERT_EQ(prefetcher.size(), 10);
+    ASSERT_EQ(prefetcher.feature_size(), 3);
+    ASSERT_EQ(prefetcher.label_size(), 1);
+    for (int i = 0; i < 5; i++) {
+        auto &batch = prefetcher.next();
+        ASSERT_EQ(batch.features.cols(), 4);
+        for (int b = 0; b < 4; b++) {
+            ASSERT_EQ(batch.features(2, b), batch.features(0, b));
+            ASSERT_EQ(batch.labels(0, b), -batch.features(0, b));
+        }
+    }
+}
+
+/* Check that the instances are converted and transformed */
+TEST(Prefetcher, PrefetcherTransform) {
+    MatrixT<float> features = MatrixT<float>::Constant(2, 6, 3.0f);
+    MatrixT<float> labels = MatrixT<float>::Constant(1, 6, 1.0f);
+    BasicDataset<float> d(features, labels);
+    Prefetcher prefetcher(d.view(), 3, 
+            [](Eigen::Ref<Matrix> features, Eigen::Ref<Matrix> labels) {
+                features.array() -= 1.0;
+                labels *= 2.0;
+            });
+    auto &batch = prefetcher.next();
+    ASSERT_EQ(batch.features, Matrix::Constant(2, 3, 2.0));
+    ASSERT_EQ(batch.labels, Matrix::Constant(1, 3, 2.0));
+}
+
+/* Check that an exception of the transform reaches the training thread */
+TEST(Prefetcher, PrefetcherError) {
+    Dataset d(Matrix::Zero(2, 4), Matrix::Zero(1, 4));
+    Prefetcher prefetcher(d.view(), 2, 
+            [](Eigen::Ref<Matrix>, Eigen::Ref<Matrix>) {
+                throw std::runtime_error("bad instance");
+            });
+    ASSERT_THROW(prefetcher.next(), std::runtime_error);
+}
+
+/* Check that training from a prefetcher gives the same model as training from
+ * the dataset, and that the prefetcher stops with batches pending.
+ */
+TEST(Prefetcher, PrefetcherTraining) {
+    Dataset d(Matrix::Random(3, 50), Matrix::Random(2, 50));
+    Model m(3);
+    m.add_layer(4, Activation::ReLU);
+    m.add_layer(2);
+    m.set_loss(LossFunction::LstSq);
+    Model copy(m);
+
+    Workspace workspace(m, 8);
+    SGD sgd(0.05);
+    m.train(d, 3, workspace, sgd);
+
+    Prefetcher prefetcher(d.view(), 8);
+    copy.train(prefetcher, 3, workspace, sgd);
+    ASSERT_EQ(copy.parameters(), m.parameters());
+
+    Prefetcher wide(d.view(), 16);
+    ASSERT_THROW(copy.train(wide, 1, workspace, sgd), std::invalid_argument);
+
+    Dataset other(Matrix::Random(2, 50), Matrix::Random(2, 50));
+    Prefetcher mismatched(other.view(), 8);
+    ASSERT_THROW(copy.train(mismatched, 1, workspace, sgd), 
+            std::invalid_argument);
+}
@@ -0,0 +1,81 @@
+/*      test_quantized.cpp
+ *
+ *      Tests for the QuantizedModel class.
+ */
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "model.h"
+#include "quantized.h"
+using namespace my_nn;
+
+namespace {
+
+Model make_model() {
+    Model m(16);
+    m.add_layer(32, Activation::ReLU);
+    m.add_layer(32, Activation::ReLU);
+    m.add_layer(4);
+    m.set_loss(LossFunction::LstSq);
+    return m;
+}
+
+}
+
+/* Check that the quantized model computes about the same outputs, in a batch
+ * or one input at a time */
+TEST(QuantizedModel, QuantizedAccuracy) {
+    Model m = make_model();
+    Matrix calibration = Matrix::Random(16, 200);
+    QuantizedModel q(m, calibration);
+    ASSERT_EQ(q.layer_number(), 3);
+    ASSERT_EQ(q.input(), 16);
+
+    // odd batch sizes also exercise the columns left after groups of four
+    Matrix inputs = Matrix::Random(16, 37);
+    Matrix expected = m.forward(inputs);
+    Matrix outputs = q.forward(inputs);
+    ASSERT_EQ(outputs.rows(), 4);
+    ASSERT_EQ(outputs.cols(), 37);
+    double range = expected.cwiseAbs().maxCoeff();
+    ASSERT_LT((outputs - expected).cwiseAbs().maxCoeff(), 0.05 * range);
+    ASSERT_EQ(q(inputs.col(5)), outputs.col(5));
+}
+
+/* Check that the weights take an eighth of their size in double; the scales
+ * and biases weigh more on such narrow layers */
+TEST(QuantizedModel, QuantizedSize) {
+    Model m = make_model();
+    QuantizedModel q(m, Matrix::Random(16, 10));
+    std::size_t weights = 32 * 16 + 32 * 32 + 4 * 32;
+    std::size_t rows = 32 + 32 + 4;
+    ASSERT_EQ(q.parameter_bytes(), weights + 2 * rows * sizeof(double));
+    ASSERT_LT(q.parameter_bytes() * 4, m.parameters().size() * sizeof(double));
+}
+
+/* Check that the ReLU is applied before requantizing, and that inputs out of 
+ * the calibrated range are clamped */
+TEST(QuantizedModel, QuantizedClamp) {
+    Model m(1);
+    m.add_layer(2, Activation::ReLU);
+    m.add_layer(1);
+    m.parameters() << 1, -1, 0, 0, 1, 1, 0;
+    QuantizedModel q(m, Matrix::Constant(1, 1, 2.0));
+    Matrix inputs(1, 3);
+    inputs << -1.0, 1.5, 4.0;
+    Matrix outputs = q.forward(inputs);
+    // |x| up to the calibrated 2
+    ASSERT_NEAR(outputs(0, 0), 1.0, 0.02);
+    ASSERT_NEAR(outputs(0, 1), 1.5, 0.02);
+    ASSERT_NEAR(outputs(0, 2), 2.0, 0.02);
+}
+
+/* Check that inputs of the wrong size are rejected */
+TEST(QuantizedModel, QuantizedInvalid) {
+    Model m = make_model();
+    ASSERT_THROW(QuantizedModel(m, Matrix::Random(8, 10)), std::invalid_argument);
+    QuantizedModel q(m, Matrix::Random(16, 10));
+    ASSERT_THROW(q.forward(Matrix::Random(8, 2)), std::invalid_argument);
+}
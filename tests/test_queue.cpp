@@ -0,0 +1,83 @@
+/*      test_queue.cpp
+ *
+ *      Tests for the BoundedQueue class.
+ */
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "queue.h"
+using namespace my_nn;
+
+/* Check that the values come out in order, and that a full queue refuses
+ * more */
+TEST(BoundedQueue, QueueOrder) {
+    BoundedQueue<int> queue(3);
+    ASSERT_EQ(queue.capacity(), 4);
+    int value;
+    ASSERT_FALSE(queue.pop(value));
+    for (int lap = 0; lap < 3; lap++) {
+        for (int i = 0; i < 4; i++) {
+            ASSERT_TRUE(queue.push(10 * lap + i));
+        }
+        ASSERT_FALSE(queue.push(-1));
+        for (int i = 0; i < 4; i++) {
+            ASSERT_TRUE(queue.pop(value));
+            ASSERT_EQ(value, 10 * lap + i);
+        }
+        ASSERT_FALSE(queue.pop(value));
+    }
+    ASSERT_THROW(BoundedQueue<int>(0), std::invalid_argument);
+}
+
+/* Check that the queue moves values which cannot be copied */
+TEST(BoundedQueue, QueueMove) {
+    BoundedQueue<std::unique_ptr<int>> queue(2);
+    ASSERT_TRUE(queue.push(std::make_unique<int>(5)));
+    std::unique_ptr<int> value;
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(*value, 5);
+}
+
+/* Check that with several producers and consumers every value comes out 
+ * exactly once */
+TEST(BoundedQueue, QueueConcurrent) {
+    const int producers = 4, consumers = 3, per_producer = 10000;
+    BoundedQueue<int> queue(64);
+    std::vector<std::atomic<int>> seen(producers * per_producer);
+    std::atomic<int> popped{0};
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < per_producer; i++) {
+                while (!queue.push(p * per_producer + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&] {
+            int value;
+            while (popped.load() < producers * per_producer) {
+                if (queue.pop(value)) {
+                    seen[value]++;
+                    popped++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (auto &count : seen) {
+        ASSERT_EQ(count.load(), 1);
+    }
+}
@@ -0,0 +1,119 @@
+/*      test_sampler.cpp
+ *
+ *      Tests for the Sampler class.
+ */
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "dataset.h"
+#include "model.h"
+#include "optimizer.h"
+#include "sampler.h"
+#include "trainer.h"
+#include "workspace.h"
+using namespace my_nn;
+
+namespace {
+
+std::vector<std::size_t> draw(Sampler &sampler, std::size_t count) {
+    std::vector<std::size_t> indices(count);
+    for (auto &index : indices) {
+        index = sampler.next();
+    }
+    return indices;
+}
+
+bool is_permutation(std::vector<std::size_t> indices) {
+    std::sort(indices.begin(), indices.end());
+    for (std::size_t i = 0; i < indices.size(); i++) {
+        if (indices[i] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+/* Check that a uniform sampler draws the sequence the training used before
+ * permutations became the default */
+TEST(Sampler, SamplerUniform) {
+    Sampler sampler(10, Sampling::Uniform);
+    std::default_random_engine generator;
+    std::uniform_int_distribution<std::size_t> distribution(0, 9);
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(sampler.next(), distribution(generator));
+    }
+}
+
+/* Check that each epoch of a permutation, the default, visits every 
+ * instance once, in a new order */
+TEST(Sampler, SamplerPermutation) {
+    ASSERT_EQ(Sampler(50).sampling(), Sampling::Permutation);
+    Sampler sampler(50, Sampling::Permutation);
+    auto first = draw(sampler, 50);
+    auto second = draw(sampler, 50);
+    ASSERT_TRUE(is_permutation(first));
+    ASSERT_TRUE(is_permutation(second));
+    ASSERT_NE(first, second);
+}
+
+/* Check that blocks are shuffled but read in order */
+TEST(Sampler, SamplerBlockShuffle) {
+    Sampler sampler(50, Sampling::BlockShuffle, 3, 8);
+    for (int epoch = 0; epoch < 3; epoch++) {
+        auto indices = draw(sampler, 50);
+        ASSERT_TRUE(is_permutation(indices));
+        for (std::size_t i = 0; i < indices.size(); i++) {
+            // a block starts at a multiple of 8, the rest follow it
+            if (indices[i] % 8 != 0) {
+                ASSERT_EQ(indices[i], indices[i - 1] + 1);
+            }
+        }
+    }
+}
+
+/* Check that the sequence only depends on the seed */
+TEST(Sampler, SamplerSeed) {
+    Sampler sampler(40, Sampling::Permutation, 7);
+    Sampler same(40, Sampling::Permutation, 7);
+    Sampler other(40, Sampling::Permutation, 8);
+    auto indices = draw(sampler, 100);
+    ASSERT_EQ(indices, draw(same, 100));
+    ASSERT_NE(indices, draw(other, 100));
+    sampler.reset();
+    ASSERT_EQ(indices, draw(sampler, 100));
+    ASSERT_THROW(Sampler(0), std::invalid_argument);
+}
+
+/* Check that the training follows the sampler, sequential or parallel */
+TEST(Sampler, SamplerTraining) {
+    Dataset data(Matrix::Random(4, 100), Matrix::Random(2, 100));
+    Model m(4);
+    m.add_layer(8, Activation::ReLU);
+    m.add_layer(2);
+    m.set_loss(LossFunction::LstSq);
+    Model copy(m);
+    auto initial_loss = (m.forward(data.features()) - data.labels()).squaredNorm();
+
+    Workspace workspace(m, 10);
+    SGD optimizer(0.05);
+    Sampler sampler(100, Sampling::BlockShuffle, 1, 16);
+    m.train(data, 5, workspace, optimizer, sampler);
+    ASSERT_LT((m.forward(data.features()) - data.labels()).squaredNorm(), 
+            initial_loss);
+
+    ParallelTrainer trainer(copy, 10, 3);
+    Sampler same(100, Sampling::BlockShuffle, 1, 16);
+    trainer.train(data, 5, optimizer, same);
+    ASSERT_NEAR((copy.parameters() - m.parameters()).norm(), 0.0, 1e-9);
+
+    Sampler wrong(99);
+    ASSERT_THROW(m.train(data, 1, workspace, optimizer, wrong), 
+            std::invalid_argument);
+}
@@ -0,0 +1,87 @@
+/*      test_server.cpp
+ *
+ *      Tests for the InferenceServer class.
+ */
+
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "model.h"
+#include "server.h"
+using namespace my_nn;
+
+namespace {
+
+Model make_model() {
+    Model m(6);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(2);
+    return m;
+}
+
+}
+
+/* Check that a single request gets the output of the model */
+TEST(InferenceServer, ServerSingle) {
+    Model m = make_model();
+    InferenceServer server(m, 8, std::chrono::microseconds(100));
+    Vector input = Vector::Random(6);
+    auto output = server.submit(input).get();
+    ASSERT_NEAR((output - m(input)).norm(), 0.0, 1e-12);
+    ASSERT_THROW(server.submit(Vector::Random(5)), std::invalid_argument);
+}
+
+/* Check that requests submitted together are served in batches */
+TEST(InferenceServer, ServerBatching) {
+    Model m = make_model();
+    Matrix inputs = Matrix::Random(6, 64);
+    std::vector<std::future<Vector>> outputs;
+    std::size_t batches;
+    {
+        InferenceServer server(m, 16, std::chrono::milliseconds(50));
+        for (int i = 0; i < 64; i++) {
+            outputs.push_back(server.submit(inputs.col(i)));
+        }
+        for (int i = 0; i < 64; i++) {
+            ASSERT_NEAR((outputs[i].get() - m(inputs.col(i))).norm(), 0.0, 
+                    1e-12);
+        }
+        ASSERT_EQ(server.requests(), 64);
+        batches = server.batches();
+    }
+    ASSERT_GE(batches, 4);
+    ASSERT_LT(batches, 64);
+}
+
+/* Check that many threads can submit at once, past the capacity of the
+ * queue, and that pending requests are served before the server stops */
+TEST(InferenceServer, ServerConcurrent) {
+    Model m = make_model();
+    Matrix inputs = Matrix::Random(6, 400);
+    std::vector<std::future<Vector>> outputs(400);
+    {
+        InferenceServer server(m, 8, std::chrono::microseconds(200), 16);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = t; i < 400; i += 4) {
+                    outputs[i] = server.submit(inputs.col(i));
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+    Matrix expected = m.forward(inputs);
+    for (int i = 0; i < 400; i++) {
+        ASSERT_EQ(outputs[i].wait_for(std::chrono::seconds(0)), 
+                std::future_status::ready);
+        ASSERT_NEAR((outputs[i].get() - expected.col(i)).norm(), 0.0, 1e-12);
+    }
+}
@@ -0,0 +1,60 @@
+/*      test_static_model.cpp
+ *
+ *      Tests for the StaticModel class. Built against the library compiled
+ *      with EIGEN_RUNTIME_NO_MALLOC.
+ */
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "model.h"
+#include "static_model.h"
+using namespace my_nn;
+
+/* Check that the static model gives the outputs of the model, for every
+ * activation. */
+TEST(StaticModel, StaticModelApply) {
+    for (auto activation : {Activation::None, Activation::ReLU, 
+            Activation::Sigmoid, Activation::Tanh, Activation::LeakyReLU,
+            Activation::SiLU, Activation::GELU}) {
+        Model m(8);
+        m.add_layer(16, activation);
+        m.add_layer(4, Activation::Softmax);
+        StaticModel<8, 16, 4> s(m);
+        for (int i = 0; i < 5; i++) {
+            Vector input = Vector::Random(8);
+            StaticModel<8, 16, 4>::InputVector fixed = input;
+            Vector expected = m(input);
+            ASSERT_TRUE(s(fixed).isApprox(expected, 1e-12));
+        }
+    }
+}
+
+/* Check the sizes, and that a model of other sizes is refused. */
+TEST(StaticModel, StaticModelSizes) {
+    static_assert(StaticModel<8, 16, 1>::input() == 8);
+    static_assert(StaticModel<8, 16, 1>::output() == 1);
+    static_assert(StaticModel<8, 16, 1>::layer_number() == 2);
+    Model m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(1);
+    ASSERT_NO_THROW((StaticModel<8, 16, 1>{m}));
+    ASSERT_THROW((StaticModel<8, 16, 2>{m}), std::invalid_argument);
+    ASSERT_THROW((StaticModel<7, 16, 1>{m}), std::invalid_argument);
+    ASSERT_THROW((StaticModel<8, 16, 1, 1>{m}), std::invalid_argument);
+}
+
+/* Check that applying the static model does not allocate. */
+TEST(StaticModel, StaticModelNoMalloc) {
+    BasicModel<float> m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(1);
+    BasicStaticModel<float, 8, 16, 1> s(m);
+    BasicStaticModel<float, 8, 16, 1>::InputVector input;
+    input.setRandom();
+    Eigen::internal::set_is_malloc_allowed(false);
+    auto output = s(input);
+    Eigen::internal::set_is_malloc_allowed(true);
+    ASSERT_NEAR(output(0), m(VectorT<float>(input))(0), 1e-5f);
+}
@@ -0,0 +1,45 @@
+/*      test_thread_pool.cpp
+ *
+ *      Tests for the ThreadPool class.
+ */
+
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "thread_pool.h"
+using namespace my_nn;
+
+/* Check that each run calls the task once per thread */
+TEST(ThreadPool, ThreadPoolRun) {
+    ThreadPool pool(4);
+    ASSERT_EQ(pool.size(), 4);
+    std::vector<int> calls(4, 0);
+    for (int i = 0; i < 100; i++) {
+        pool.run([&](std::size_t index) { calls[index]++; });
+    }
+    for (auto count : calls) {
+        ASSERT_EQ(count, 100);
+    }
+}
+
+/* Check that exceptions thrown by the task reach the caller, and that the
+ * pool is still usable afterwards.
+ */
+TEST(ThreadPool, ThreadPoolException) {
+    ThreadPool pool(3);
+    ASSERT_THROW(pool.run([](std::size_t index) {
+                if (index == 2) {
+                    throw std::runtime_error("task failed");
+                }
+            }), std::runtime_error);
+    int sum = 0;
+    std::mutex mutex;
+    pool.run([&](std::size_t index) { 
+            std::lock_guard<std::mutex> lock(mutex);
+            sum += index; 
+    });
+    ASSERT_EQ(sum, 3);
+}
@@ -0,0 +1,125 @@
+/*      test_trainer.cpp
+ *
+ *      Tests for the ParallelTrainer class.
+ */
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "model.h"
+#include "optimizer.h"
+#include "sampler.h"
+#include "trainer.h"
+using namespace my_nn;
+
+namespace {
+
+Model small_model() {
+    Model m(4);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(8, Activation::ReLU);
+    m.add_layer(2);
+    m.set_loss(LossFunction::LstSq);
+    return m;
+}
+
+} // namespace
+
+/* Check that the parallel training follows the same path as the sequential
+ * one, for several numbers of threads, including some that do not divide the
+ * batch size or exceed it.
+ */
+TEST(ParallelTrainer, ParallelMatchesSequential) {
+    Dataset data(Matrix::Random(4, 200), Matrix::Random(2, 200));
+    auto reference = small_model();
+    SGD sequential_optimizer(0.05);
+    reference.train(data, 2, 12, sequential_optimizer);
+
+    for (std::size_t threads : {1, 2, 3, 4, 16}) {
+        auto m = small_model();
+        ParallelTrainer trainer(m, 12, threads);
+        ASSERT_EQ(trainer.threads(), threads);
+        SGD optimizer(0.05);
+        trainer.train(data, 2, optimizer);
+        ASSERT_NEAR((m.parameters() - reference.parameters()).norm(), 0.0, 1e-9);
+    }
+}
+
+/* Check that the parallel training reduces the error */
+TEST(ParallelTrainer, ParallelTraining) {
+    Matrix features = Matrix::Random(4, 500);
+    Matrix labels(2, 500);
+    labels.row(0) = features.colwise().squaredNorm();
+    labels.row(1) = features.row(0) - features.row(1);
+    Dataset data(features, labels);
+    auto m = small_model();
+    auto initial_loss = (m.forward(features) - labels).squaredNorm();
+    ParallelTrainer trainer(m, 32, 4);
+    Adam optimizer(0.01);
+    trainer.train(data, 20, optimizer);
+    auto final_loss = (m.forward(features) - labels).squaredNorm();
+
+    auto compare = [] (elem_type a, elem_type b) { return a < b; };
+    EXPECT_PRED2(compare, final_loss, initial_loss);
+}
+
+/* Check that datasets of another shape than the model are refused */
+TEST(ParallelTrainer, ParallelDatasetMismatch) {
+    auto m = small_model();
+    ParallelTrainer trainer(m, 8, 2);
+    SGD optimizer(0.05);
+    Dataset features(Matrix::Random(3, 20), Matrix::Random(2, 20));
+    ASSERT_THROW(trainer.train(features, 1, optimizer), std::invalid_argument);
+    Dataset labels(Matrix::Random(4, 20), Matrix::Random(3, 20));
+    Sampler sampler(20);
+    ASSERT_THROW(trainer.train(labels, 1, optimizer, sampler), 
+            std::invalid_argument);
+}
+
+/* Check that Hogwild training with one thread is plain stochastic gradient
+ * descent.
+ */
+TEST(ParallelTrainer, HogwildSingleThread) {
+    Dataset data(Matrix::Random(4, 100), Matrix::Random(2, 100));
+    auto reference = small_model();
+    SGD optimizer(0.05);
+    reference.train(data, 3, 8, optimizer);
+
+    auto m = small_model();
+    ParallelTrainer trainer(m, 8, 1);
+    trainer.train_hogwild(data, 3, 0.05);
+    ASSERT_NEAR((m.parameters() - reference.parameters()).norm(), 0.0, 1e-9);
+}
+
+/* Check that Hogwild training with several threads reduces the error */
+TEST(ParallelTrainer, HogwildTraining) {
+    Matrix features = Matrix::Random(4, 500);
+    Matrix labels(2, 500);
+    labels.row(0) = features.colwise().squaredNorm();
+    labels.row(1) = features.row(0) - features.row(1);
+    Dataset data(features, labels);
+    auto m = small_model();
+    auto initial_loss = (m.forward(features) - labels).squaredNorm();
+    ParallelTrainer trainer(m, 16, 4);
+    trainer.train_hogwild(data, 20, 0.02);
+    auto final_loss = (m.forward(features) - labels).squaredNorm();
+
+    auto compare = [] (elem_type a, elem_type b) { return a < b; };
+    EXPECT_PRED2(compare, final_loss, initial_loss);
+}
+
+/* Check that Hogwild training refuses datasets of another shape than the
+ * model, leaving its parameters untouched.
+ */
+TEST(ParallelTrainer, HogwildDatasetMismatch) {
+    auto m = small_model();
+    Vector before = m.parameters();
+    ParallelTrainer trainer(m, 8, 2);
+    Dataset features(Matrix::Random(5, 20), Matrix::Random(2, 20));
+    ASSERT_THROW(trainer.train_hogwild(features, 1, 0.05), 
+            std::invalid_argument);
+    Dataset labels(Matrix::Random(4, 20), Matrix::Random(1, 20));
+    ASSERT_THROW(trainer.train_hogwild(labels, 1, 0.05), std::invalid_argument);
+    ASSERT_EQ(m.parameters(), before);
+}
@@ -0,0 +1,111 @@
+/*      test_workspace.cpp
+ *
+ *      Tests for the Workspace class and the allocation-free training steps.
+ *      Built against the library compiled with EIGEN_RUNTIME_NO_MALLOC.
+ */
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "model.h"
+#include "workspace.h"
+using namespace my_nn;
+
+/* Check that the workspace is sized after the layers of the model */
+TEST(Workspace, WorkspaceConstruct) {
+    Model m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(2);
+    Workspace w(m, 32);
+    ASSERT_EQ(w.batch_size(), 32);
+    ASSERT_EQ(w.inputs().rows(), 8);
+    ASSERT_EQ(w.targets().rows(), 2);
+    ASSERT_EQ(w.gradients().size(), 2);
+    ASSERT_EQ(w.gradients()[0].first.rows(), 16);
+    ASSERT_EQ(w.gradients()[0].first.cols(), 8);
+    ASSERT_EQ(w.gradients()[1].second.size(), 2);
+}
+
+/* Check that the gradient written in the workspace is the allocated one, also
+ * for a batch narrower than the workspace.
+ */
+TEST(Workspace, WorkspaceGradient) {
+    Model m(4);
+    m.add_layer(10, Activation::ReLU);
+    m.add_layer(3);
+    m.set_loss(LossFunction::LstSq);
+    Workspace w(m, 8);
+    Matrix inputs = Matrix::Random(4, 5);
+    Matrix labels = Matrix::Random(3, 5);
+    m.gradient(inputs, labels, w);
+    auto expected = m.gradient(inputs, labels);
+    for (int k = 0; k < 2; k++) {
+        ASSERT_NEAR((w.gradients()[k].first - expected[k].first).norm(), 0.0, 1e-10);
+        ASSERT_NEAR((w.gradients()[k].second - expected[k].second).norm(), 0.0, 1e-10);
+    }
+}
+
+/* Check that inputs and targets of another shape than the model are refused */
+TEST(Workspace, WorkspaceGradientMismatch) {
+    Model m(4);
+    m.add_layer(10, Activation::ReLU);
+    m.add_layer(3);
+    Workspace w(m, 8);
+    ASSERT_THROW(m.gradient(Matrix::Random(5, 6), Matrix::Random(3, 6), w),
+            std::invalid_argument);
+    ASSERT_THROW(m.gradient(Matrix::Random(4, 6), Matrix::Random(2, 6), w),
+            std::invalid_argument);
+    ASSERT_THROW(m.gradient(Matrix::Random(4, 6), Matrix::Random(3, 5), w),
+            std::invalid_argument);
+    ASSERT_THROW(m.gradient(Matrix::Random(4, 9), Matrix::Random(3, 9), w),
+            std::invalid_argument);
+}
+
+/* Check that the training steps do not allocate once the workspace exists */
+TEST(Workspace, WorkspaceNoMalloc) {
+    Model m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(1);
+    m.set_loss(LossFunction::LstSq);
+    Workspace w(m, 32);
+    Adam optimizer;
+    optimizer.reset(m);
+    Matrix features = Matrix::Random(8, 100);
+    Matrix labels = Matrix::Random(1, 100);
+
+    Eigen::internal::set_is_malloc_allowed(false);
+    for (int step = 0; step < 10; step++) {
+        for (std::size_t b = 0; b < w.batch_size(); b++) {
+            w.inputs().col(b) = features.col((step * 32 + b) % 100);
+            w.targets().col(b) = labels.col((step * 32 + b) % 100);
+        }
+        m.gradient(w.inputs(), w.targets(), w);
+        optimizer.step(m, w);
+    }
+    // a narrower last batch
+    m.gradient(w.inputs().leftCols(3), w.targets().leftCols(3), w);
+    optimizer.step(m, w);
+    Eigen::internal::set_is_malloc_allowed(true);
+    SUCCEED();
+}
+
+/* Check that a whole training run does not allocate once the workspace
+ * exists.
+ */
+TEST(Workspace, WorkspaceTrainNoMalloc) {
+    Model m(8);
+    m.add_layer(16, Activation::ReLU);
+    m.add_layer(1);
+    m.set_loss(LossFunction::LstSq);
+    Workspace w(m, 16);
+    Momentum optimizer(0.01);
+    optimizer.reset(m);
+    Dataset data(Matrix::Random(8, 100), Matrix::Random(1, 100));
+
+    Eigen::internal::set_is_malloc_allowed(false);
+    m.train(data, 3, w, optimizer);
+    Eigen::internal::set_is_malloc_allowed(true);
+    SUCCEED();
+}